@@ -0,0 +1,128 @@
+/*
+ * bench_bus.c — Hot-path benchmarks for the nbs-bus C core.
+ *
+ * Covers the coordination paths every agent round-trips through:
+ *   - bus_publish latency at several queue depths (the temp+rename
+ *     publish should not care how many events are already pending)
+ *   - bus_check latency vs queue depth (this is a directory scan, so
+ *     depth is exactly what it must be measured against)
+ *
+ * Run via `make bench` in src/nbs-bus. Output format and methodology:
+ * see bench_common.h. bus_check prints to stdout; its output is routed
+ * to /dev/null for the timed region so the BENCH lines stay parseable.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bus.h"
+#include "bench_common.h"
+
+static char events_dir[256];
+
+/* Run fn-ish bus_check with stdout parked on /dev/null */
+static long long timed_check_us(void)
+{
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (saved < 0 || devnull < 0) {
+        fprintf(stderr, "Error: cannot redirect stdout: %s\n",
+                strerror(errno));
+        exit(1);
+    }
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+
+    long long t0 = bench_now_us();
+    int rc = bus_check(events_dir, NULL);
+    long long dt = bench_now_us() - t0;
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    if (rc != 0) {
+        fprintf(stderr, "Error: bus_check failed\n");
+        exit(1);
+    }
+    return dt;
+}
+
+static void fill_queue(int from, int to)
+{
+    for (int i = from; i < to; i++) {
+        if (bus_publish(events_dir, "bench", "evt", BUS_PRIORITY_NORMAL,
+                        "payload for the depth fill") != 0) {
+            fprintf(stderr, "Error: fill publish %d failed\n", i);
+            exit(1);
+        }
+    }
+}
+
+static void drain_queue(void)
+{
+    if (bus_ack_all(events_dir, NULL) != 0) {
+        fprintf(stderr, "Error: ack_all failed\n");
+        exit(1);
+    }
+}
+
+static void bench_publish_at_depth(const char *name, int depth, int iters)
+{
+    fill_queue(0, depth);
+
+    long long *samples = malloc(sizeof(long long) * (size_t)iters);
+    for (int i = 0; i < iters; i++) {
+        long long t0 = bench_now_us();
+        if (bus_publish(events_dir, "bench", "timed", BUS_PRIORITY_NORMAL,
+                        "timed publish payload") != 0) {
+            fprintf(stderr, "Error: timed publish failed\n");
+            exit(1);
+        }
+        samples[i] = bench_now_us() - t0;
+    }
+    bench_report(name, samples, iters);
+    free(samples);
+    drain_queue();
+}
+
+static void bench_check_at_depth(const char *name, int depth, int iters)
+{
+    fill_queue(0, depth);
+
+    long long *samples = malloc(sizeof(long long) * (size_t)iters);
+    for (int i = 0; i < iters; i++)
+        samples[i] = timed_check_us();
+    bench_report(name, samples, iters);
+    free(samples);
+    drain_queue();
+}
+
+int main(void)
+{
+    snprintf(events_dir, sizeof(events_dir), "/tmp/bench_bus_XXXXXX");
+    if (mkdtemp(events_dir) == NULL) {
+        fprintf(stderr, "Error: mkdtemp failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    printf("=== nbs-bus benchmarks ===\n");
+    bus_set_quiet(1); /* filenames would drown the BENCH lines */
+
+    bench_publish_at_depth("bus_publish_empty_queue", 0, 200);
+    bench_publish_at_depth("bus_publish_500_pending", 500, 200);
+    bench_check_at_depth("bus_check_10_pending", 10, 100);
+    bench_check_at_depth("bus_check_500_pending", 500, 50);
+
+    /* Best-effort cleanup (same convention as the unit tests) */
+    char cmd[300];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", events_dir);
+    (void)system(cmd);
+    return 0;
+}
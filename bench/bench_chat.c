@@ -0,0 +1,234 @@
+/*
+ * bench_chat.c — Hot-path benchmarks for the nbs-chat C core.
+ *
+ * Covers the paths agents hit constantly:
+ *   - chat_send latency at several history sizes (the fast path must
+ *     stay O(message), not O(file))
+ *   - chat_read throughput over a full history
+ *   - base64 encode/decode MB/s (every v1 message crosses it twice)
+ *   - lock acquisition, uncontended and against a spinning holder
+ *
+ * Run via `make bench` in src/nbs-chat. Output format and methodology:
+ * see bench_common.h. All work happens under a private mkdtemp dir.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include "chat_file.h"
+#include "lock.h"
+#include "base64.h"
+#include "bench_common.h"
+
+static char bench_dir[256];
+
+static void cleanup_chat(const char *path)
+{
+    char side[512];
+    unlink(path);
+    snprintf(side, sizeof(side), "%s.lock", path);
+    unlink(side);
+    snprintf(side, sizeof(side), "%s.idx", path);
+    unlink(side);
+    snprintf(side, sizeof(side), "%s.cursors", path);
+    unlink(side);
+}
+
+/* Fill a chat with n messages of typical agent-chatter length */
+static void prefill(const char *path, int n)
+{
+    const char *msg = "status update: finished the previous step, "
+                      "starting the next one now";
+    for (int i = 0; i < n; i++) {
+        if (chat_send(path, "bench", msg) != 0) {
+            fprintf(stderr, "Error: prefill send %d failed\n", i);
+            exit(1);
+        }
+    }
+}
+
+/* --- chat_send latency vs history size --- */
+
+static void bench_send_at_depth(const char *name, int depth, int iters)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/send_%d.chat", bench_dir, depth);
+    if (chat_create(path) != 0) {
+        fprintf(stderr, "Error: chat_create failed\n");
+        exit(1);
+    }
+    prefill(path, depth);
+
+    long long *samples = malloc(sizeof(long long) * (size_t)iters);
+    for (int i = 0; i < iters; i++) {
+        long long t0 = bench_now_us();
+        if (chat_send(path, "bench", "timed message for the send path") != 0) {
+            fprintf(stderr, "Error: timed send failed\n");
+            exit(1);
+        }
+        samples[i] = bench_now_us() - t0;
+    }
+    bench_report(name, samples, iters);
+    free(samples);
+    cleanup_chat(path);
+}
+
+/* --- chat_read throughput over a full history --- */
+
+static void bench_read_full(int depth, int iters)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/read.chat", bench_dir);
+    if (chat_create(path) != 0) {
+        fprintf(stderr, "Error: chat_create failed\n");
+        exit(1);
+    }
+    prefill(path, depth);
+
+    long long *samples = malloc(sizeof(long long) * (size_t)iters);
+    for (int i = 0; i < iters; i++) {
+        chat_state_t state;
+        long long t0 = bench_now_us();
+        if (chat_read(path, &state) != 0) {
+            fprintf(stderr, "Error: timed read failed\n");
+            exit(1);
+        }
+        samples[i] = bench_now_us() - t0;
+        chat_state_free(&state);
+    }
+    bench_report("chat_read_5000_msgs", samples, iters);
+    free(samples);
+    cleanup_chat(path);
+}
+
+/* --- base64 encode/decode throughput --- */
+
+static void bench_base64(int iters)
+{
+    size_t raw_len = 1024 * 1024;
+    unsigned char *raw = malloc(raw_len);
+    for (size_t i = 0; i < raw_len; i++)
+        raw[i] = (unsigned char)(i * 131 + 7);
+    size_t enc_size = base64_encoded_size(raw_len);
+    char *enc = malloc(enc_size);
+    unsigned char *dec = malloc(raw_len + 4);
+
+    long long *samples = malloc(sizeof(long long) * (size_t)iters);
+    for (int i = 0; i < iters; i++) {
+        long long t0 = bench_now_us();
+        if (base64_encode(raw, raw_len, enc, enc_size) < 0) {
+            fprintf(stderr, "Error: base64_encode failed\n");
+            exit(1);
+        }
+        samples[i] = bench_now_us() - t0;
+    }
+    bench_report("base64_encode_1mb", samples, iters);
+
+    size_t enc_len = strlen(enc);
+    for (int i = 0; i < iters; i++) {
+        long long t0 = bench_now_us();
+        if (base64_decode(enc, enc_len, dec, raw_len + 4) < 0) {
+            fprintf(stderr, "Error: base64_decode failed\n");
+            exit(1);
+        }
+        samples[i] = bench_now_us() - t0;
+    }
+    bench_report("base64_decode_1mb", samples, iters);
+
+    free(samples);
+    free(raw);
+    free(enc);
+    free(dec);
+}
+
+/* --- lock acquisition, idle and contended --- */
+
+static void bench_lock(int iters)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/lock.chat", bench_dir);
+    if (chat_create(path) != 0) {
+        fprintf(stderr, "Error: chat_create failed\n");
+        exit(1);
+    }
+
+    long long *samples = malloc(sizeof(long long) * (size_t)iters);
+    for (int i = 0; i < iters; i++) {
+        long long t0 = bench_now_us();
+        int fd = chat_lock_acquire(path);
+        samples[i] = bench_now_us() - t0;
+        if (fd < 0) {
+            fprintf(stderr, "Error: lock acquire failed\n");
+            exit(1);
+        }
+        chat_lock_release(fd);
+    }
+    bench_report("lock_acquire_idle", samples, iters);
+
+    /* Contended: a child grabs and drops the lock as fast as it can
+     * while the parent times its own acquisitions. p99 here is what an
+     * agent sees when it races another writer. */
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "Error: fork failed: %s\n", strerror(errno));
+        exit(1);
+    }
+    if (pid == 0) {
+        for (;;) {
+            int fd = chat_lock_acquire(path);
+            if (fd >= 0)
+                chat_lock_release(fd);
+            sched_yield();
+        }
+    }
+
+    for (int i = 0; i < iters; i++) {
+        long long t0 = bench_now_us();
+        int fd = chat_lock_acquire(path);
+        samples[i] = bench_now_us() - t0;
+        if (fd < 0) {
+            fprintf(stderr, "Error: contended lock acquire failed\n");
+            kill(pid, SIGKILL);
+            exit(1);
+        }
+        chat_lock_release(fd);
+        sched_yield();
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    bench_report("lock_acquire_contended", samples, iters);
+
+    free(samples);
+    cleanup_chat(path);
+}
+
+int main(void)
+{
+    snprintf(bench_dir, sizeof(bench_dir), "/tmp/bench_chat_XXXXXX");
+    if (mkdtemp(bench_dir) == NULL) {
+        fprintf(stderr, "Error: mkdtemp failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    printf("=== nbs-chat benchmarks ===\n");
+
+    bench_send_at_depth("chat_send_empty_file", 0, 200);
+    bench_send_at_depth("chat_send_1000_msgs", 1000, 200);
+    bench_send_at_depth("chat_send_5000_msgs", 5000, 200);
+    bench_read_full(5000, 30);
+    bench_base64(50);
+    bench_lock(200);
+
+    /* Best-effort cleanup (same convention as the unit tests) */
+    char cmd[300];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", bench_dir);
+    (void)system(cmd);
+    return 0;
+}
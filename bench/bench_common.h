@@ -0,0 +1,61 @@
+/*
+ * bench_common.h — Shared timing and reporting for the C core benchmarks.
+ *
+ * Every benchmark collects per-iteration wall-clock samples and reports
+ * one machine-readable line:
+ *
+ *   BENCH: name=<id> iters=<n> min_us=<x> median_us=<y> p99_us=<z>
+ *
+ * min answers "how fast can this path go", median "what a caller
+ * usually sees", p99 "what the unlucky caller sees". Regressions are
+ * caught by diffing these lines between runs (benchmark_results/ keeps
+ * the history); see falsification-methodology.md for the project's
+ * stance on what a benchmark must rule out before its numbers count.
+ */
+
+#ifndef NBS_BENCH_COMMON_H
+#define NBS_BENCH_COMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Monotonic microseconds — immune to wall-clock steps mid-run */
+static long long bench_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static int bench_cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * bench_report — Sort the samples and print the summary line.
+ *
+ * Sorting mutates samples[]; callers are done with them by then.
+ * p99 uses the nearest-rank method: the sample below which 99% of
+ * iterations fall (for n < 100 this is simply the maximum).
+ */
+static void bench_report(const char *name, long long *samples, int n)
+{
+    if (n <= 0) {
+        fprintf(stderr, "Error: benchmark %s collected no samples\n", name);
+        return;
+    }
+    qsort(samples, (size_t)n, sizeof(samples[0]), bench_cmp_ll);
+    int p99_idx = (n * 99) / 100;
+    if (p99_idx >= n)
+        p99_idx = n - 1;
+    printf("BENCH: name=%s iters=%d min_us=%lld median_us=%lld p99_us=%lld\n",
+           name, n, samples[0], samples[n / 2], samples[p99_idx]);
+    fflush(stdout);
+}
+
+#endif /* NBS_BENCH_COMMON_H */
@@ -28,6 +28,10 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
 
 /* ------------------------------------------------------------------ */
 /* Priority helpers                                                    */
@@ -51,6 +55,19 @@ const char *bus_priority_to_str(int p)
     return priority_names[p];
 }
 
+/* ------------------------------------------------------------------ */
+/* Output mode                                                         */
+/* ------------------------------------------------------------------ */
+
+/* When set, bus_publish skips the filename print on success. Used by
+ * in-process library callers whose stdout belongs to something else. */
+static int g_quiet = 0;
+
+void bus_set_quiet(int quiet)
+{
+    g_quiet = quiet;
+}
+
 /* ------------------------------------------------------------------ */
 /* Internal helpers                                                    */
 /* ------------------------------------------------------------------ */
@@ -265,6 +282,11 @@ static int event_compare(const void *a, const void *b)
     return 0;
 }
 
+/* Journal-mode helpers (defined below, after the configuration loader) */
+static int journal_mode(const char *events_dir);
+static int journal_scan(const char *events_dir, bus_event_t *events,
+                        int max_events, long long *offsets);
+
 /* Scan events directory and populate array. Returns count, -1 on error. */
 static int scan_events(const char *events_dir, bus_event_t *events, int max_events)
 {
@@ -272,6 +294,9 @@ static int scan_events(const char *events_dir, bus_event_t *events, int max_even
     ASSERT_MSG(events != NULL, "scan_events: events is NULL");
     ASSERT_MSG(max_events > 0, "scan_events: max_events <= 0: %d", max_events);
 
+    if (journal_mode(events_dir))
+        return journal_scan(events_dir, events, max_events, NULL);
+
     DIR *dir = opendir(events_dir);
     if (!dir) return -1;
 
@@ -326,6 +351,7 @@ int bus_load_config(const char *events_dir, bus_config_t *cfg)
     cfg->retention_max_bytes = BUS_DEFAULT_MAX_BYTES;
     cfg->dedup_window_s = BUS_DEFAULT_DEDUP_WINDOW;
     cfg->ack_timeout_s = BUS_DEFAULT_ACK_TIMEOUT;
+    cfg->queue_journal = BUS_DEFAULT_QUEUE_JOURNAL;
 
     /* Try to open config.yaml */
     char config_path[BUS_MAX_FULLPATH];
@@ -379,6 +405,12 @@ int bus_load_config(const char *events_dir, bus_config_t *cfg)
             if (errno == 0 && *endp == '\0' && v >= 0 &&
                 v <= LLONG_MAX / 1000000LL)
                 cfg->ack_timeout_s = v;
+        } else if (key_len == 12 && strncmp(line, "queue-format", 12) == 0) {
+            if (strcmp(val, "journal") == 0)
+                cfg->queue_journal = 1;
+            else if (strcmp(val, "files") == 0)
+                cfg->queue_journal = 0;
+            /* Other values ignored (default used) */
         }
         /* Unknown keys silently ignored */
     }
@@ -387,6 +419,434 @@ int bus_load_config(const char *events_dir, bus_config_t *cfg)
     return 0;
 }
 
+/* ------------------------------------------------------------------ */
+/* Journal queue format (opt-in: config.yaml queue-format: journal)    */
+/*                                                                     */
+/* One append-only file, events_dir/journal, of records:               */
+/*                                                                     */
+/*   u32le content_len | u8 flags | content bytes                      */
+/*                                                                     */
+/* flags: 0 = pending, 1 = acknowledged. content is text: a            */
+/* "file: <virtual-filename>\n" line followed by exactly the YAML an   */
+/* event file would contain, so bus_read output matches either mode.   */
+/* events_dir/journal.base holds the byte offset of the first record   */
+/* that may still be pending; everything before it is consumed and     */
+/* reclaimable by bus_prune (which compacts the journal). Appends are  */
+/* a single O_APPEND write and acks a single one-byte pwrite, so       */
+/* concurrent publishers and one consumer coexist without locking —    */
+/* like directory mode, compaction assumes a quiet queue.              */
+/* ------------------------------------------------------------------ */
+
+#define JOURNAL_REC_HDR 5  /* u32le content_len + u8 flags */
+
+static void put_u32le(unsigned char *p, unsigned int v)
+{
+    p[0] = (unsigned char)(v & 0xff);
+    p[1] = (unsigned char)((v >> 8) & 0xff);
+    p[2] = (unsigned char)((v >> 16) & 0xff);
+    p[3] = (unsigned char)((v >> 24) & 0xff);
+}
+
+static unsigned int get_u32le(const unsigned char *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/* Is this queue configured for journal mode? */
+static int journal_mode(const char *events_dir)
+{
+    bus_config_t cfg;
+    bus_load_config(events_dir, &cfg);
+    return cfg.queue_journal;
+}
+
+static void journal_file_path(const char *events_dir, char *buf, size_t len)
+{
+    snprintf(buf, len, "%s/%s", events_dir, BUS_JOURNAL_FILE);
+}
+
+/* Read the consumed-offset cursor; 0 when absent or unreadable */
+static long long journal_read_base(const char *events_dir)
+{
+    char path[BUS_MAX_FULLPATH];
+    snprintf(path, sizeof(path), "%s/%s", events_dir, BUS_JOURNAL_BASE_FILE);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+
+    long long base = 0;
+    if (fscanf(fp, "offset: %lld", &base) != 1 || base < 0)
+        base = 0;
+    fclose(fp);
+    return base;
+}
+
+/* Persist the consumed-offset cursor (temp + rename) */
+static int journal_write_base(const char *events_dir, long long base)
+{
+    char path[BUS_MAX_FULLPATH];
+    char tmp[BUS_MAX_FULLPATH];
+    snprintf(path, sizeof(path), "%s/%s", events_dir, BUS_JOURNAL_BASE_FILE);
+    snprintf(tmp, sizeof(tmp), "%s/.tmp-%s-%d", events_dir,
+             BUS_JOURNAL_BASE_FILE, (int)getpid());
+
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return -1;
+    if (fprintf(fp, "offset: %lld\n", base) < 0 || fclose(fp) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    if (rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * journal_build_content — Serialise one event into a malloc'd buffer.
+ *
+ * Layout: "file: <filename>\n" + the same YAML publish_one writes.
+ * Returns the content (caller frees) and its length, or NULL on
+ * allocation failure. Also copies the virtual filename to out_filename
+ * (BUS_MAX_FILENAME bytes).
+ */
+static char *journal_build_content(const char *source, const char *type,
+                                   int priority, const char *payload,
+                                   long long ts_us, char *out_filename,
+                                   size_t *out_len)
+{
+    snprintf(out_filename, BUS_MAX_FILENAME, "%lld-%s-%s-%d.event",
+             ts_us, source, type, (int)getpid());
+
+    char iso_time[32];
+    format_iso8601(iso_time, sizeof(iso_time));
+
+    /* Worst case: fixed lines + payload with every line re-indented */
+    size_t payload_len = payload ? strlen(payload) : 0;
+    size_t cap = 1024 + strlen(source) * 2 + strlen(type) * 2 +
+                 payload_len * 3 + 16;
+    char *buf = malloc(cap);
+    if (!buf) return NULL;
+
+    int n = snprintf(buf, cap,
+                     "file: %s\n"
+                     "source: %s\n"
+                     "type: %s\n"
+                     "priority: %s\n"
+                     "timestamp: %s\n"
+                     "dedup-key: %s:%s\n",
+                     out_filename, source, type,
+                     bus_priority_to_str(priority), iso_time, source, type);
+    ASSERT_MSG(n > 0 && (size_t)n < cap,
+               "journal_build_content: header truncated (%d of %zu)", n, cap);
+    size_t len = (size_t)n;
+
+    if (payload && payload[0] != '\0') {
+        len += (size_t)snprintf(buf + len, cap - len, "payload: |\n");
+        const char *pp = payload;
+        while (*pp) {
+            ASSERT_MSG(len + 3 < cap, "journal_build_content: payload overflow");
+            buf[len++] = ' ';
+            buf[len++] = ' ';
+            const char *nl = strchr(pp, '\n');
+            size_t seg = nl ? (size_t)(nl - pp + 1) : strlen(pp);
+            ASSERT_MSG(len + seg + 1 < cap, "journal_build_content: payload overflow");
+            memcpy(buf + len, pp, seg);
+            len += seg;
+            if (!nl) {
+                buf[len++] = '\n';
+                break;
+            }
+            pp = nl + 1;
+        }
+    }
+    buf[len] = '\0';
+    *out_len = len;
+    return buf;
+}
+
+/*
+ * journal_append_one — Append one framed record to an open journal fd.
+ *
+ * The header and content go out in a single write() on an O_APPEND fd,
+ * so concurrent publishers interleave whole records. The caller fsyncs
+ * (once per publish, or once per batch).
+ */
+static int journal_append_one(int fd, const char *source, const char *type,
+                              int priority, const char *payload,
+                              long long ts_us, char *out_filename)
+{
+    size_t content_len = 0;
+    char *content = journal_build_content(source, type, priority, payload,
+                                          ts_us, out_filename, &content_len);
+    if (!content) {
+        fprintf(stderr, "Error: out of memory building journal record\n");
+        return -1;
+    }
+
+    size_t rec_len = JOURNAL_REC_HDR + content_len;
+    unsigned char *rec = malloc(rec_len);
+    if (!rec) {
+        free(content);
+        fprintf(stderr, "Error: out of memory building journal record\n");
+        return -1;
+    }
+    put_u32le(rec, (unsigned int)content_len);
+    rec[4] = 0; /* pending */
+    memcpy(rec + JOURNAL_REC_HDR, content, content_len);
+    free(content);
+
+    ssize_t wr = write(fd, rec, rec_len);
+    free(rec);
+    if (wr != (ssize_t)rec_len) {
+        fprintf(stderr, "Error: journal append failed: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Open the journal for appending (created on first publish) */
+static int journal_open_append(const char *events_dir)
+{
+    char path[BUS_MAX_FULLPATH];
+    journal_file_path(events_dir, path, sizeof(path));
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0600);
+    if (fd < 0)
+        fprintf(stderr, "Error: cannot open journal: %s\n", strerror(errno));
+    return fd;
+}
+
+/*
+ * journal_load — Read the journal from the consumed-offset cursor to
+ * EOF into a malloc'd buffer.
+ *
+ * Returns the buffer (caller frees; NULL with *out_size 0 when the
+ * journal is missing or fully consumed) and sets *out_base to the
+ * cursor so callers can translate buffer positions to file offsets.
+ * Returns -1 on read error via *out_err.
+ */
+static char *journal_load(const char *events_dir, long long *out_base,
+                          size_t *out_size, int *out_err)
+{
+    *out_size = 0;
+    *out_err = 0;
+    *out_base = journal_read_base(events_dir);
+
+    char path[BUS_MAX_FULLPATH];
+    journal_file_path(events_dir, path, sizeof(path));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL; /* no journal yet — empty queue */
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < *out_base) {
+        close(fd);
+        *out_err = 1;
+        return NULL;
+    }
+    size_t size = (size_t)(st.st_size - *out_base);
+    if (size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    char *buf = malloc(size);
+    if (!buf) {
+        close(fd);
+        *out_err = 1;
+        return NULL;
+    }
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = pread(fd, buf + got, size - got, *out_base + (long long)got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    close(fd);
+    if (got != size) {
+        free(buf);
+        *out_err = 1;
+        return NULL;
+    }
+    *out_size = size;
+    return buf;
+}
+
+/* Extract a "key: value\n" field from in-memory record content.
+ * Returns 0 and copies the value (NUL-terminated) on success, -1 if
+ * the field is absent. */
+static int journal_field(const char *content, size_t content_len,
+                         const char *key, char *val, size_t val_len)
+{
+    size_t key_len = strlen(key);
+    size_t pos = 0;
+    while (pos < content_len) {
+        const char *line = content + pos;
+        const char *nl = memchr(line, '\n', content_len - pos);
+        size_t llen = nl ? (size_t)(nl - line) : content_len - pos;
+        if (llen > key_len + 2 &&
+            memcmp(line, key, key_len) == 0 &&
+            line[key_len] == ':' && line[key_len + 1] == ' ') {
+            size_t vlen = llen - key_len - 2;
+            if (vlen >= val_len) vlen = val_len - 1;
+            memcpy(val, line + key_len + 2, vlen);
+            val[vlen] = '\0';
+            return 0;
+        }
+        pos += llen + (nl ? 1 : 0);
+    }
+    return -1;
+}
+
+/*
+ * journal_scan — Populate events[] with pending journal records.
+ *
+ * Mirrors scan_events for journal mode: one cursor seek, then a linear
+ * parse of the unconsumed tail, skipping acknowledged records. When
+ * offsets is non-NULL it receives each event's record offset in the
+ * journal file (for ack). A record with broken framing ends the scan
+ * with a warning — later records are unreachable without a resync
+ * marker. Returns the count, or -1 on read error.
+ */
+static int journal_scan(const char *events_dir, bus_event_t *events,
+                        int max_events, long long *offsets)
+{
+    long long base = 0;
+    size_t size = 0;
+    int err = 0;
+    char *buf = journal_load(events_dir, &base, &size, &err);
+    if (err) return -1;
+    if (!buf) return 0;
+
+    int count = 0;
+    size_t pos = 0;
+    while (pos < size && count < max_events) {
+        if (size - pos < JOURNAL_REC_HDR) {
+            fprintf(stderr, "Warning: truncated journal record at offset %lld\n",
+                    base + (long long)pos);
+            break;
+        }
+        unsigned int content_len = get_u32le((unsigned char *)buf + pos);
+        unsigned char flags = (unsigned char)buf[pos + 4];
+        if (content_len == 0 || size - pos - JOURNAL_REC_HDR < content_len) {
+            fprintf(stderr, "Warning: malformed journal record at offset %lld\n",
+                    base + (long long)pos);
+            break;
+        }
+        const char *content = buf + pos + JOURNAL_REC_HDR;
+        long long rec_off = base + (long long)pos;
+        pos += JOURNAL_REC_HDR + content_len;
+
+        if (flags != 0)
+            continue; /* acknowledged */
+
+        bus_event_t *ev = &events[count];
+        if (journal_field(content, content_len, "file",
+                          ev->filename, sizeof(ev->filename)) != 0)
+            continue; /* skip records without an identity */
+        if (parse_event_filename_timestamp(ev->filename, &ev->timestamp_us) != 0)
+            continue;
+
+        char prio[32];
+        ev->priority = BUS_PRIORITY_NORMAL;
+        if (journal_field(content, content_len, "priority",
+                          prio, sizeof(prio)) == 0) {
+            int pv = bus_priority_from_str(prio);
+            if (pv >= 0) ev->priority = pv;
+        }
+        if (journal_field(content, content_len, "source",
+                          ev->source, sizeof(ev->source)) != 0)
+            ev->source[0] = '\0';
+        if (journal_field(content, content_len, "type",
+                          ev->type, sizeof(ev->type)) != 0)
+            ev->type[0] = '\0';
+
+        if (offsets) offsets[count] = rec_off;
+        count++;
+    }
+
+    free(buf);
+    return count;
+}
+
+/*
+ * journal_find — Locate a pending record by virtual filename.
+ *
+ * On success returns 0 with the record's file offset and content
+ * length/flags offset derivable by the caller. Returns 1 when not
+ * found, -1 on read error.
+ */
+static int journal_find(const char *events_dir, const char *event_file,
+                        long long *rec_off, unsigned int *content_len_out)
+{
+    long long base = 0;
+    size_t size = 0;
+    int err = 0;
+    char *buf = journal_load(events_dir, &base, &size, &err);
+    if (err) return -1;
+    if (!buf) return 1;
+
+    int found = 1;
+    size_t pos = 0;
+    while (pos < size) {
+        if (size - pos < JOURNAL_REC_HDR) break;
+        unsigned int content_len = get_u32le((unsigned char *)buf + pos);
+        unsigned char flags = (unsigned char)buf[pos + 4];
+        if (content_len == 0 || size - pos - JOURNAL_REC_HDR < content_len)
+            break;
+        const char *content = buf + pos + JOURNAL_REC_HDR;
+
+        char fname[BUS_MAX_FILENAME];
+        if (flags == 0 &&
+            journal_field(content, content_len, "file",
+                          fname, sizeof(fname)) == 0 &&
+            strcmp(fname, event_file) == 0) {
+            *rec_off = base + (long long)pos;
+            *content_len_out = content_len;
+            found = 0;
+            break;
+        }
+        pos += JOURNAL_REC_HDR + content_len;
+    }
+
+    free(buf);
+    return found;
+}
+
+/*
+ * journal_advance_base — Move the consumed-offset cursor past any
+ * leading acknowledged records so scans start at live data.
+ */
+static void journal_advance_base(const char *events_dir)
+{
+    long long base = 0;
+    size_t size = 0;
+    int err = 0;
+    char *buf = journal_load(events_dir, &base, &size, &err);
+    if (err || !buf) return;
+
+    long long new_base = base;
+    size_t pos = 0;
+    while (pos < size) {
+        if (size - pos < JOURNAL_REC_HDR) break;
+        unsigned int content_len = get_u32le((unsigned char *)buf + pos);
+        unsigned char flags = (unsigned char)buf[pos + 4];
+        if (content_len == 0 || size - pos - JOURNAL_REC_HDR < content_len)
+            break;
+        if (flags == 0)
+            break; /* first pending record — stop */
+        pos += JOURNAL_REC_HDR + content_len;
+        new_base = base + (long long)pos;
+    }
+    free(buf);
+
+    if (new_base != base)
+        journal_write_base(events_dir, new_base);
+}
+
 /* ------------------------------------------------------------------ */
 /* Comparison for prune: sort by timestamp ascending (oldest first)    */
 /* ------------------------------------------------------------------ */
@@ -410,18 +870,21 @@ static int prune_compare(const void *a, const void *b)
 /* Public API                                                          */
 /* ------------------------------------------------------------------ */
 
-int bus_publish(const char *events_dir, const char *source, const char *type,
-                int priority, const char *payload)
+/*
+ * publish_validate — Shared argument checks for the publish paths.
+ *
+ * Returns 0 if source/type are publishable, -1 (with stderr message)
+ * otherwise.
+ */
+static int publish_validate(const char *source, const char *type, int priority)
 {
-    ASSERT_MSG(events_dir != NULL, "bus_publish: events_dir is NULL");
-    ASSERT_MSG(source != NULL, "bus_publish: source is NULL");
-    ASSERT_MSG(type != NULL, "bus_publish: type is NULL");
-    ASSERT_MSG(source[0] != '\0', "bus_publish: source is empty");
-    ASSERT_MSG(type[0] != '\0', "bus_publish: type is empty");
+    ASSERT_MSG(source != NULL, "publish_validate: source is NULL");
+    ASSERT_MSG(type != NULL, "publish_validate: type is NULL");
+    ASSERT_MSG(source[0] != '\0', "publish_validate: source is empty");
+    ASSERT_MSG(type[0] != '\0', "publish_validate: type is empty");
     ASSERT_MSG(priority >= 0 && priority <= 3,
-               "bus_publish: invalid priority %d", priority);
+               "publish_validate: invalid priority %d", priority);
 
-    /* Validate no whitespace in source/type */
     if (has_whitespace(source)) {
         fprintf(stderr, "Error: source handle must not contain whitespace\n");
         return -1;
@@ -430,15 +893,22 @@ int bus_publish(const char *events_dir, const char *source, const char *type,
         fprintf(stderr, "Error: event type must not contain whitespace\n");
         return -1;
     }
+    return 0;
+}
 
-    /* Verify events directory exists */
+/*
+ * publish_dir_ready — Verify events_dir exists and processed/ is present.
+ *
+ * Returns 0 on success, -1 (with stderr message) otherwise.
+ */
+static int publish_dir_ready(const char *events_dir)
+{
     struct stat st;
     if (stat(events_dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
         fprintf(stderr, "Error: events directory not found: %s\n", events_dir);
         return -1;
     }
 
-    /* Ensure processed/ subdirectory exists */
     char processed_dir[BUS_MAX_FULLPATH];
     snprintf(processed_dir, sizeof(processed_dir), "%s/processed", events_dir);
     if (stat(processed_dir, &st) != 0) {
@@ -448,13 +918,24 @@ int bus_publish(const char *events_dir, const char *source, const char *type,
             return -1;
         }
     }
+    return 0;
+}
 
-    long long ts_us = now_us();
-
-    /* Build filename — use microsecond timestamp for unique ordering.
-     * Append PID to prevent collisions from concurrent processes
-     * publishing the same source+type within the same microsecond.
-     */
+/*
+ * publish_one — Write a single event file atomically (temp + rename).
+ *
+ * ts_us is supplied by the caller so batch publishes can keep filenames
+ * strictly increasing even when several events land in the same
+ * microsecond (the filename is <ts>-<source>-<type>-<pid>.event, so two
+ * same-type events in one tick would otherwise collide).
+ *
+ * On success returns 0 and copies the event filename into out_filename
+ * (at least BUS_MAX_FILENAME bytes). Returns -1 on error.
+ */
+static int publish_one(const char *events_dir, const char *source,
+                       const char *type, int priority, const char *payload,
+                       long long ts_us, char *out_filename)
+{
     char filename[BUS_MAX_FILENAME];
     snprintf(filename, sizeof(filename), "%lld-%s-%s-%d.event",
              ts_us, source, type, (int)getpid());
@@ -528,90 +1009,649 @@ int bus_publish(const char *events_dir, const char *source, const char *type,
         return -1;
     }
 
-    /* Print the filename to stdout */
-    printf("%s\n", filename);
+    snprintf(out_filename, BUS_MAX_FILENAME, "%s", filename);
     return 0;
 }
 
-int bus_check(const char *events_dir, const char *handle)
+/*
+ * copy_payload_block — Stream a payload from `in` to `out` as a YAML
+ * block scalar, re-indenting each line with two spaces.
+ *
+ * Works in fixed 8 KB chunks so memory stays constant whatever the
+ * payload size. Writes nothing (not even the "payload: |" key) when
+ * `in` is empty, matching publish_one's treatment of empty payloads.
+ * A missing final newline is supplied, as the event format requires.
+ *
+ * Returns 0 on success, -1 on I/O error.
+ */
+static int copy_payload_block(FILE *out, FILE *in)
 {
-    ASSERT_MSG(events_dir != NULL, "bus_check: events_dir is NULL");
+    char buf[8192];
+    size_t n = fread(buf, 1, sizeof(buf), in);
+    if (n == 0)
+        return ferror(in) ? -1 : 0;
 
-    struct stat st;
-    if (stat(events_dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
-        fprintf(stderr, "Error: events directory not found: %s\n", events_dir);
+    if (fprintf(out, "payload: |\n") < 0)
         return -1;
-    }
 
-    /* WARNING: ~3.1 MB stack allocation (sizeof(bus_event_t) * 4096).
-     * Requires sufficient stack size (e.g. 8 MB default on Linux).
-     * Flagged for architect review — do not refactor to heap without approval. */
-    bus_event_t events[BUS_MAX_EVENTS];
-    int count = scan_events(events_dir, events, BUS_MAX_EVENTS);
-    if (count < 0) {
-        fprintf(stderr, "Error: cannot scan events directory: %s\n",
-                strerror(errno));
+    int at_line_start = 1;
+    char last = '\0';
+    do {
+        size_t i = 0;
+        while (i < n) {
+            if (at_line_start && fwrite("  ", 1, 2, out) != 2)
+                return -1;
+            char *nl = memchr(buf + i, '\n', n - i);
+            size_t seg = nl ? (size_t)(nl - (buf + i)) + 1 : n - i;
+            if (fwrite(buf + i, 1, seg, out) != seg)
+                return -1;
+            at_line_start = (nl != NULL);
+            i += seg;
+        }
+        last = buf[n - 1];
+        n = fread(buf, 1, sizeof(buf), in);
+    } while (n > 0);
+    if (ferror(in))
         return -1;
-    }
-
-    if (count == 0)
-        return 0;
-
-    /* Sort by priority then timestamp */
-    qsort(events, (size_t)count, sizeof(bus_event_t), event_compare);
-
-    /* Print results, optionally filtered by source handle */
-    long long current_us = now_us();
-    for (int i = 0; i < count; i++) {
-        if (handle && handle[0] != '\0' &&
-            strcmp(events[i].source, handle) != 0)
-            continue;
-        char age[32];
-        format_age(current_us - events[i].timestamp_us, age, sizeof(age));
-        printf("[%s] %s (%s)\n",
-               bus_priority_to_str(events[i].priority),
-               events[i].filename,
-               age);
-    }
 
+    if (last != '\n' && fputc('\n', out) == EOF)
+        return -1;
     return 0;
 }
 
-int bus_read(const char *events_dir, const char *event_file)
+/*
+ * publish_one_stream — publish_one, but the payload comes from a
+ * stream instead of an argv string. The payload is copied straight
+ * into the temp event file in fixed-size chunks, so payload size is
+ * disk-bound and memory use is constant.
+ */
+static int publish_one_stream(const char *events_dir, const char *source,
+                              const char *type, int priority,
+                              FILE *payload_fp, long long ts_us,
+                              char *out_filename)
 {
-    ASSERT_MSG(events_dir != NULL, "bus_read: events_dir is NULL");
-    ASSERT_MSG(event_file != NULL, "bus_read: event_file is NULL");
+    char filename[BUS_MAX_FILENAME];
+    snprintf(filename, sizeof(filename), "%lld-%s-%s-%d.event",
+             ts_us, source, type, (int)getpid());
 
-    /* SECURITY: reject path traversal — event_file must be a bare filename */
-    if (event_file[0] == '\0' || strchr(event_file, '/') != NULL ||
-        strcmp(event_file, "..") == 0 || strcmp(event_file, ".") == 0) {
-        fprintf(stderr, "Error: invalid event filename (path traversal): %s\n",
-                event_file);
-        return -1;
-    }
+    char tmp_path[BUS_MAX_FULLPATH];
+    char final_path[BUS_MAX_FULLPATH];
+    snprintf(tmp_path, sizeof(tmp_path), "%s/.tmp-%lld-%d.event",
+             events_dir, ts_us, (int)getpid());
+    snprintf(final_path, sizeof(final_path), "%s/%s", events_dir, filename);
 
-    char filepath[BUS_MAX_FULLPATH];
-    snprintf(filepath, sizeof(filepath), "%s/%s", events_dir, event_file);
+    char iso_time[32];
+    format_iso8601(iso_time, sizeof(iso_time));
 
-    FILE *fp = fopen(filepath, "r");
+    FILE *fp = fopen(tmp_path, "w");
     if (!fp) {
-        fprintf(stderr, "Error: event not found: %s\n", event_file);
+        fprintf(stderr, "Error: cannot create event file: %s\n", strerror(errno));
         return -1;
     }
 
-    char buf[4096];
-    size_t n;
-    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
-        if (fwrite(buf, 1, n, stdout) != n) {
-            fprintf(stderr, "Error: failed to write event to stdout\n");
-            fclose(fp);
-            return -1;
-        }
+    int write_err = 0;
+    if (fprintf(fp, "source: %s\n", source) < 0) write_err = 1;
+    if (!write_err && fprintf(fp, "type: %s\n", type) < 0) write_err = 1;
+    if (!write_err && fprintf(fp, "priority: %s\n", bus_priority_to_str(priority)) < 0) write_err = 1;
+    if (!write_err && fprintf(fp, "timestamp: %s\n", iso_time) < 0) write_err = 1;
+    if (!write_err && fprintf(fp, "dedup-key: %s:%s\n", source, type) < 0) write_err = 1;
+    if (!write_err && copy_payload_block(fp, payload_fp) != 0) write_err = 1;
+
+    if (fclose(fp) != 0) {
+        if (unlink(tmp_path) != 0)
+            fprintf(stderr, "Warning: failed to remove temp file %s: %s\n",
+                    tmp_path, strerror(errno));
+        fprintf(stderr, "Error: failed to flush event file: %s\n", strerror(errno));
+        return -1;
     }
 
-    fclose(fp);
-    return 0;
-}
+    if (write_err) {
+        if (unlink(tmp_path) != 0)
+            fprintf(stderr, "Warning: failed to remove temp file %s: %s\n",
+                    tmp_path, strerror(errno));
+        fprintf(stderr, "Error: write error creating event file\n");
+        return -1;
+    }
+
+    if (rename(tmp_path, final_path) != 0) {
+        if (unlink(tmp_path) != 0)
+            fprintf(stderr, "Warning: failed to remove temp file %s: %s\n",
+                    tmp_path, strerror(errno));
+        fprintf(stderr, "Error: failed to finalise event file: %s\n",
+                strerror(errno));
+        return -1;
+    }
+
+    snprintf(out_filename, BUS_MAX_FILENAME, "%s", filename);
+    return 0;
+}
+
+int bus_publish_stream(const char *events_dir, const char *source,
+                       const char *type, int priority, FILE *payload_fp)
+{
+    ASSERT_MSG(events_dir != NULL, "bus_publish_stream: events_dir is NULL");
+    ASSERT_MSG(source != NULL, "bus_publish_stream: source is NULL");
+    ASSERT_MSG(type != NULL, "bus_publish_stream: type is NULL");
+    ASSERT_MSG(payload_fp != NULL, "bus_publish_stream: payload_fp is NULL");
+
+    if (publish_validate(source, type, priority) != 0)
+        return -1;
+    if (publish_dir_ready(events_dir) != 0)
+        return -1;
+
+    char filename[BUS_MAX_FILENAME];
+    if (journal_mode(events_dir)) {
+        /* Journal framing needs content_len up front and the record in
+         * one write (concurrent publishers interleave whole records),
+         * so the streamed payload is staged once in heap via
+         * open_memstream — still free of argv limits, but not
+         * constant-memory like directory mode. */
+        long long ts_us = now_us();
+        snprintf(filename, sizeof(filename), "%lld-%s-%s-%d.event",
+                 ts_us, source, type, (int)getpid());
+
+        char iso_time[32];
+        format_iso8601(iso_time, sizeof(iso_time));
+
+        char *content = NULL;
+        size_t content_len = 0;
+        FILE *mem = open_memstream(&content, &content_len);
+        if (!mem) {
+            fprintf(stderr, "Error: out of memory building journal record\n");
+            return -1;
+        }
+        int write_err = 0;
+        if (fprintf(mem,
+                    "file: %s\n"
+                    "source: %s\n"
+                    "type: %s\n"
+                    "priority: %s\n"
+                    "timestamp: %s\n"
+                    "dedup-key: %s:%s\n",
+                    filename, source, type, bus_priority_to_str(priority),
+                    iso_time, source, type) < 0)
+            write_err = 1;
+        if (!write_err && copy_payload_block(mem, payload_fp) != 0)
+            write_err = 1;
+        if (fclose(mem) != 0)
+            write_err = 1;
+        if (write_err) {
+            free(content);
+            fprintf(stderr, "Error: failed to build journal record\n");
+            return -1;
+        }
+
+        int fd = journal_open_append(events_dir);
+        if (fd < 0) {
+            free(content);
+            return -1;
+        }
+        size_t rec_len = JOURNAL_REC_HDR + content_len;
+        unsigned char *rec = malloc(rec_len);
+        if (!rec) {
+            free(content);
+            close(fd);
+            fprintf(stderr, "Error: out of memory building journal record\n");
+            return -1;
+        }
+        put_u32le(rec, (unsigned int)content_len);
+        rec[4] = 0; /* pending */
+        memcpy(rec + JOURNAL_REC_HDR, content, content_len);
+        free(content);
+
+        ssize_t wr = write(fd, rec, rec_len);
+        free(rec);
+        if (wr != (ssize_t)rec_len) {
+            fprintf(stderr, "Error: journal append failed: %s\n",
+                    strerror(errno));
+            close(fd);
+            return -1;
+        }
+        if (fsync(fd) != 0) {
+            fprintf(stderr, "Error: journal fsync failed: %s\n",
+                    strerror(errno));
+            close(fd);
+            return -1;
+        }
+        close(fd);
+    } else if (publish_one_stream(events_dir, source, type, priority,
+                                  payload_fp, now_us(), filename) != 0) {
+        return -1;
+    }
+
+    if (!g_quiet)
+        printf("%s\n", filename);
+    return 0;
+}
+
+int bus_publish(const char *events_dir, const char *source, const char *type,
+                int priority, const char *payload)
+{
+    ASSERT_MSG(events_dir != NULL, "bus_publish: events_dir is NULL");
+    ASSERT_MSG(source != NULL, "bus_publish: source is NULL");
+    ASSERT_MSG(type != NULL, "bus_publish: type is NULL");
+
+    if (publish_validate(source, type, priority) != 0)
+        return -1;
+    if (publish_dir_ready(events_dir) != 0)
+        return -1;
+
+    char filename[BUS_MAX_FILENAME];
+    if (journal_mode(events_dir)) {
+        /* One append, one flush — no temp file, no rename */
+        int fd = journal_open_append(events_dir);
+        if (fd < 0) return -1;
+        if (journal_append_one(fd, source, type, priority, payload,
+                               now_us(), filename) != 0) {
+            close(fd);
+            return -1;
+        }
+        if (fsync(fd) != 0) {
+            fprintf(stderr, "Error: journal fsync failed: %s\n",
+                    strerror(errno));
+            close(fd);
+            return -1;
+        }
+        close(fd);
+    } else if (publish_one(events_dir, source, type, priority, payload,
+                           now_us(), filename) != 0) {
+        return -1;
+    }
+
+    /* Print the filename to stdout (unless a library caller muted us) */
+    if (!g_quiet)
+        printf("%s\n", filename);
+    return 0;
+}
+
+int bus_publish_batch(const char *events_dir, const bus_batch_event_t *events,
+                      int n)
+{
+    ASSERT_MSG(events_dir != NULL, "bus_publish_batch: events_dir is NULL");
+    ASSERT_MSG(events != NULL, "bus_publish_batch: events is NULL");
+    ASSERT_MSG(n > 0, "bus_publish_batch: n must be positive, got %d", n);
+
+    /* Validate everything up front — a batch with a bad entry publishes
+     * nothing rather than stopping half way through. */
+    for (int i = 0; i < n; i++) {
+        ASSERT_MSG(events[i].source != NULL,
+                   "bus_publish_batch: event %d source is NULL", i);
+        ASSERT_MSG(events[i].type != NULL,
+                   "bus_publish_batch: event %d type is NULL", i);
+        if (publish_validate(events[i].source, events[i].type,
+                             events[i].priority) != 0)
+            return -1;
+    }
+    if (publish_dir_ready(events_dir) != 0)
+        return -1;
+
+    if (journal_mode(events_dir)) {
+        /* All records through one fd, one fsync at the end */
+        int fd = journal_open_append(events_dir);
+        if (fd < 0) return -1;
+
+        long long ts_us = 0;
+        for (int i = 0; i < n; i++) {
+            long long now = now_us();
+            ts_us = (now > ts_us) ? now : ts_us + 1;
+
+            char filename[BUS_MAX_FILENAME];
+            if (journal_append_one(fd, events[i].source, events[i].type,
+                                   events[i].priority, events[i].payload,
+                                   ts_us, filename) != 0) {
+                fprintf(stderr, "Error: batch publish failed at event %d of %d\n",
+                        i + 1, n);
+                close(fd);
+                return -1;
+            }
+            if (!g_quiet)
+                printf("%s\n", filename);
+        }
+        if (fsync(fd) != 0) {
+            fprintf(stderr, "Error: journal fsync failed: %s\n",
+                    strerror(errno));
+            close(fd);
+            return -1;
+        }
+        close(fd);
+        return 0;
+    }
+
+    /* Write all events; each is individually atomic (temp + rename) but
+     * the batch is not transactional — a failure leaves earlier events
+     * published. Timestamps are forced strictly increasing so same-type
+     * events in one batch get distinct filenames and preserve order. */
+    long long ts_us = 0;
+    for (int i = 0; i < n; i++) {
+        long long now = now_us();
+        ts_us = (now > ts_us) ? now : ts_us + 1;
+
+        char filename[BUS_MAX_FILENAME];
+        if (publish_one(events_dir, events[i].source, events[i].type,
+                        events[i].priority, events[i].payload,
+                        ts_us, filename) != 0) {
+            fprintf(stderr, "Error: batch publish failed at event %d of %d\n",
+                    i + 1, n);
+            return -1;
+        }
+        if (!g_quiet)
+            printf("%s\n", filename);
+    }
+
+    /* One directory fsync for the whole batch: the renames above are
+     * durable once the directory metadata is flushed, so N events cost
+     * one metadata flush instead of N. */
+    int dfd = open(events_dir, O_RDONLY);
+    if (dfd < 0) {
+        fprintf(stderr, "Error: cannot open events directory for fsync: %s\n",
+                strerror(errno));
+        return -1;
+    }
+    if (fsync(dfd) != 0) {
+        fprintf(stderr, "Error: events directory fsync failed: %s\n",
+                strerror(errno));
+        close(dfd);
+        return -1;
+    }
+    close(dfd);
+
+    return 0;
+}
+
+/*
+ * print_pending — Print pending events matching handle in check format.
+ *
+ * Shared between bus_check and bus_wait. Returns the number of events
+ * printed, or -1 on scan error.
+ */
+static int print_pending(const char *events_dir, const char *handle)
+{
+    /* WARNING: ~3.1 MB stack allocation (sizeof(bus_event_t) * 4096).
+     * Requires sufficient stack size (e.g. 8 MB default on Linux).
+     * Flagged for architect review — do not refactor to heap without approval. */
+    bus_event_t events[BUS_MAX_EVENTS];
+    int count = scan_events(events_dir, events, BUS_MAX_EVENTS);
+    if (count < 0) {
+        fprintf(stderr, "Error: cannot scan events directory: %s\n",
+                strerror(errno));
+        return -1;
+    }
+
+    if (count == 0)
+        return 0;
+
+    /* Sort by priority then timestamp */
+    qsort(events, (size_t)count, sizeof(bus_event_t), event_compare);
+
+    /* Print results, optionally filtered by source handle */
+    int printed = 0;
+    long long current_us = now_us();
+    for (int i = 0; i < count; i++) {
+        if (handle && handle[0] != '\0' &&
+            strcmp(events[i].source, handle) != 0)
+            continue;
+        char age[32];
+        format_age(current_us - events[i].timestamp_us, age, sizeof(age));
+        printf("[%s] %s (%s)\n",
+               bus_priority_to_str(events[i].priority),
+               events[i].filename,
+               age);
+        printed++;
+    }
+
+    return printed;
+}
+
+#ifdef __linux__
+
+/* Monotonic milliseconds, for wait timeout accounting */
+static long long wait_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Event-driven wait: watch the events directory with inotify and block
+ * in poll(2) until a .event file lands or the deadline passes.
+ *
+ * Events are published by rename into the directory (IN_MOVED_TO);
+ * IN_CREATE and IN_CLOSE_WRITE are watched too so hand-written event
+ * files also wake us. Temp files (.tmp-*) and the processed/
+ * subdirectory do not end in ".event" and are filtered out, so a
+ * publish wakes us exactly once.
+ *
+ * Returns 0/3/-1 with bus_wait's contract, or -2 if inotify could not
+ * be set up (caller falls back to sleep-based polling).
+ */
+static int bus_wait_inotify(const char *events_dir, const char *handle,
+                            int timeout_secs)
+{
+    int ifd = inotify_init1(IN_CLOEXEC);
+    if (ifd < 0) return -2;
+
+    int wd = inotify_add_watch(ifd, events_dir,
+                               IN_MOVED_TO | IN_CREATE | IN_CLOSE_WRITE);
+    if (wd < 0) {
+        close(ifd);
+        return -2; /* e.g. watch limit reached — fall back */
+    }
+
+    /* Check the baseline AFTER the watch is armed so an event landing
+     * between check and wait raises a notification instead of being
+     * lost. Matching events may already be pending. */
+    int printed = print_pending(events_dir, handle);
+    if (printed != 0) {
+        close(ifd);
+        return (printed > 0) ? 0 : -1;
+    }
+
+    long long deadline_ms = wait_now_ms() + (long long)timeout_secs * 1000;
+
+    for (;;) {
+        long long remaining_ms = deadline_ms - wait_now_ms();
+        if (remaining_ms <= 0) {
+            close(ifd);
+            return BUS_EXIT_NOT_FOUND; /* Timeout */
+        }
+        if (remaining_ms > INT_MAX) remaining_ms = INT_MAX;
+
+        struct pollfd pfd = { .fd = ifd, .events = POLLIN };
+        int pr = poll(&pfd, 1, (int)remaining_ms);
+        if (pr < 0) {
+            if (errno == EINTR) continue;
+            close(ifd);
+            return -1;
+        }
+        if (pr == 0) {
+            close(ifd);
+            return BUS_EXIT_NOT_FOUND; /* Timeout */
+        }
+
+        /* Drain the pending notification batch, checking whether any
+         * names a .event file (or the journal, in journal mode). */
+        char buf[4096]
+            __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t n = read(ifd, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            close(ifd);
+            return -1;
+        }
+
+        int relevant = 0;
+        for (ssize_t off = 0; off < n;) {
+            const struct inotify_event *ev =
+                (const struct inotify_event *)(buf + off);
+            if (ev->len > 0) {
+                size_t nlen = strlen(ev->name);
+                if (nlen > 6 && strcmp(ev->name + nlen - 6, ".event") == 0)
+                    relevant = 1;
+                else if (strcmp(ev->name, BUS_JOURNAL_FILE) == 0)
+                    relevant = 1;
+            }
+            off += (ssize_t)(sizeof(struct inotify_event) + ev->len);
+        }
+        if (!relevant) continue;
+
+        printed = print_pending(events_dir, handle);
+        if (printed != 0) {
+            close(ifd);
+            return (printed > 0) ? 0 : -1;
+        }
+        /* A .event file landed but from a different source — keep waiting */
+    }
+}
+
+#endif /* __linux__ */
+
+int bus_wait(const char *events_dir, const char *handle, int timeout_secs)
+{
+    ASSERT_MSG(events_dir != NULL, "bus_wait: events_dir is NULL");
+    ASSERT_MSG(timeout_secs >= 0,
+               "bus_wait: timeout_secs is negative: %d", timeout_secs);
+
+    struct stat st;
+    if (stat(events_dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "Error: events directory not found: %s\n", events_dir);
+        return -1;
+    }
+
+#ifdef __linux__
+    int irc = bus_wait_inotify(events_dir, handle, timeout_secs);
+    if (irc != -2) return irc;
+    /* inotify unavailable — fall through to sleep-based polling */
+#endif
+
+    int printed = print_pending(events_dir, handle);
+    if (printed != 0)
+        return (printed > 0) ? 0 : -1;
+
+    for (int elapsed = 0; elapsed < timeout_secs; elapsed++) {
+        sleep(1);
+        printed = print_pending(events_dir, handle);
+        if (printed != 0)
+            return (printed > 0) ? 0 : -1;
+    }
+
+    return BUS_EXIT_NOT_FOUND; /* Timeout */
+}
+
+int bus_check(const char *events_dir, const char *handle)
+{
+    ASSERT_MSG(events_dir != NULL, "bus_check: events_dir is NULL");
+
+    struct stat st;
+    if (stat(events_dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "Error: events directory not found: %s\n", events_dir);
+        return -1;
+    }
+
+    return (print_pending(events_dir, handle) >= 0) ? 0 : -1;
+}
+
+int bus_read(const char *events_dir, const char *event_file)
+{
+    ASSERT_MSG(events_dir != NULL, "bus_read: events_dir is NULL");
+    ASSERT_MSG(event_file != NULL, "bus_read: event_file is NULL");
+
+    /* SECURITY: reject path traversal — event_file must be a bare filename */
+    if (event_file[0] == '\0' || strchr(event_file, '/') != NULL ||
+        strcmp(event_file, "..") == 0 || strcmp(event_file, ".") == 0) {
+        fprintf(stderr, "Error: invalid event filename (path traversal): %s\n",
+                event_file);
+        return -1;
+    }
+
+    if (journal_mode(events_dir)) {
+        long long rec_off = 0;
+        unsigned int content_len = 0;
+        int frc = journal_find(events_dir, event_file, &rec_off, &content_len);
+        if (frc != 0) {
+            fprintf(stderr, "Error: event not found: %s\n", event_file);
+            return -1;
+        }
+
+        char jpath[BUS_MAX_FULLPATH];
+        journal_file_path(events_dir, jpath, sizeof(jpath));
+        int fd = open(jpath, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Error: event not found: %s\n", event_file);
+            return -1;
+        }
+        /* Stream the record to stdout in fixed chunks — payload size is
+         * disk-bound, memory stays constant. The first chunk drops the
+         * "file: ..." identity line so the output matches what an event
+         * file would contain. */
+        char buf[8192];
+        long long off = rec_off + JOURNAL_REC_HDR;
+        unsigned int remaining = content_len;
+        int first = 1;
+        while (remaining > 0) {
+            size_t want = remaining < sizeof(buf) ? remaining : sizeof(buf);
+            ssize_t got = pread(fd, buf, want, off);
+            if (got <= 0) {
+                fprintf(stderr, "Error: cannot read journal record\n");
+                close(fd);
+                return -1;
+            }
+            const char *out = buf;
+            size_t out_len = (size_t)got;
+            if (first) {
+                const char *body = memchr(buf, '\n', out_len);
+                if (body) {
+                    out = body + 1;
+                    out_len -= (size_t)(body + 1 - buf);
+                    first = 0;
+                } else {
+                    out_len = 0; /* identity line longer than a chunk */
+                }
+            }
+            if (out_len > 0 && fwrite(out, 1, out_len, stdout) != out_len) {
+                fprintf(stderr, "Error: failed to write event to stdout\n");
+                close(fd);
+                return -1;
+            }
+            off += got;
+            remaining -= (unsigned int)got;
+        }
+        close(fd);
+        return 0;
+    }
+
+    char filepath[BUS_MAX_FULLPATH];
+    snprintf(filepath, sizeof(filepath), "%s/%s", events_dir, event_file);
+
+    FILE *fp = fopen(filepath, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: event not found: %s\n", event_file);
+        return -1;
+    }
+
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        if (fwrite(buf, 1, n, stdout) != n) {
+            fprintf(stderr, "Error: failed to write event to stdout\n");
+            fclose(fp);
+            return -1;
+        }
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/* Processed-size cache — definitions after the dedup ledger below */
+typedef struct {
+    long long sig;    /* processed/ mtime (ns) when the counts were taken */
+    long long count;  /* .event files in processed/ */
+    long long bytes;  /* their total size */
+} proc_stats_t;
+static long long proc_stats_sig(const char *events_dir);
+static int proc_stats_load(const char *events_dir, proc_stats_t *s);
+static void proc_stats_store(const char *events_dir, const proc_stats_t *s);
 
 int bus_ack(const char *events_dir, const char *event_file)
 {
@@ -626,6 +1666,38 @@ int bus_ack(const char *events_dir, const char *event_file)
         return -1;
     }
 
+    if (journal_mode(events_dir)) {
+        long long rec_off = 0;
+        unsigned int content_len = 0;
+        int frc = journal_find(events_dir, event_file, &rec_off, &content_len);
+        if (frc != 0) {
+            fprintf(stderr, "Error: event not found: %s\n", event_file);
+            return -1;
+        }
+
+        char jpath[BUS_MAX_FULLPATH];
+        journal_file_path(events_dir, jpath, sizeof(jpath));
+        int fd = open(jpath, O_WRONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Error: cannot acknowledge event: %s\n",
+                    strerror(errno));
+            return -1;
+        }
+        unsigned char acked = 1;
+        if (pwrite(fd, &acked, 1, rec_off + 4) != 1) {
+            fprintf(stderr, "Error: cannot acknowledge event: %s\n",
+                    strerror(errno));
+            close(fd);
+            return -1;
+        }
+        close(fd);
+
+        /* Retire any fully-acknowledged prefix so the next scan seeks
+         * straight to live records */
+        journal_advance_base(events_dir);
+        return 0;
+    }
+
     char src_path[BUS_MAX_FULLPATH];
     char dst_path[BUS_MAX_FULLPATH];
     snprintf(src_path, sizeof(src_path), "%s/%s", events_dir, event_file);
@@ -650,11 +1722,29 @@ int bus_ack(const char *events_dir, const char *event_file)
         return -1;
     }
 
+    long long pre_sig = proc_stats_sig(events_dir);
+
     if (rename(src_path, dst_path) != 0) {
         fprintf(stderr, "Error: cannot acknowledge event: %s\n", strerror(errno));
         return -1;
     }
 
+    /* Keep the processed-size cache warm: our rename invalidated the
+     * old signature, so fold this file in and re-sign — but only if the
+     * cache was valid up to the rename; stale counters must not be
+     * re-signed. Best effort — a racing ack between our rename and the
+     * new signature stat can leave the counters off by one, and the
+     * cache is advisory (prune always re-verifies with a real scan
+     * before deleting anything). */
+    proc_stats_t ps;
+    if (pre_sig != 0 && proc_stats_load(events_dir, &ps) == 0 &&
+        ps.sig == pre_sig) {
+        ps.count += 1;
+        ps.bytes += (long long)st.st_size;
+        ps.sig = proc_stats_sig(events_dir);
+        proc_stats_store(events_dir, &ps);
+    }
+
     return 0;
 }
 
@@ -695,6 +1785,104 @@ int bus_prune(const char *events_dir, long long max_bytes)
     ASSERT_MSG(events_dir != NULL, "bus_prune: events_dir is NULL");
     ASSERT_MSG(max_bytes > 0, "bus_prune: max_bytes <= 0: %lld", max_bytes);
 
+    if (journal_mode(events_dir)) {
+        /* The consumed prefix before journal.base is the journal-mode
+         * analogue of processed/: compact it away once it exceeds the
+         * limit. Rewrites the journal (temp + rename) — like directory
+         * prune, run this while the queue is quiet. */
+        long long base = journal_read_base(events_dir);
+        if (base <= max_bytes) {
+            printf("Pruned 0 events (%.1f KB / %.1f KB limit)\n",
+                   (double)base / 1024.0, (double)max_bytes / 1024.0);
+            return 0;
+        }
+
+        char jpath[BUS_MAX_FULLPATH];
+        journal_file_path(events_dir, jpath, sizeof(jpath));
+
+        int fd = open(jpath, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Error: cannot open journal: %s\n",
+                    strerror(errno));
+            return -1;
+        }
+
+        /* Count the records being discarded for the report */
+        int pruned = 0;
+        {
+            long long off = 0;
+            unsigned char hdr[JOURNAL_REC_HDR];
+            while (off + JOURNAL_REC_HDR <= base &&
+                   pread(fd, hdr, JOURNAL_REC_HDR, off) == JOURNAL_REC_HDR) {
+                unsigned int clen = get_u32le(hdr);
+                if (clen == 0) break;
+                off += JOURNAL_REC_HDR + clen;
+                pruned++;
+            }
+        }
+
+        char tmp[BUS_MAX_FULLPATH];
+        snprintf(tmp, sizeof(tmp), "%s/.tmp-%s-%d", events_dir,
+                 BUS_JOURNAL_FILE, (int)getpid());
+        int wfd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (wfd < 0) {
+            fprintf(stderr, "Error: cannot compact journal: %s\n",
+                    strerror(errno));
+            close(fd);
+            return -1;
+        }
+
+        long long remaining = 0;
+        char buf[65536];
+        long long off = base;
+        for (;;) {
+            ssize_t n = pread(fd, buf, sizeof(buf), off);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                fprintf(stderr, "Error: journal read failed: %s\n",
+                        strerror(errno));
+                close(fd);
+                close(wfd);
+                unlink(tmp);
+                return -1;
+            }
+            if (n == 0) break;
+            if (write(wfd, buf, (size_t)n) != n) {
+                fprintf(stderr, "Error: journal write failed: %s\n",
+                        strerror(errno));
+                close(fd);
+                close(wfd);
+                unlink(tmp);
+                return -1;
+            }
+            off += n;
+            remaining += n;
+        }
+        close(fd);
+        if (fsync(wfd) != 0 || close(wfd) != 0) {
+            fprintf(stderr, "Error: journal flush failed: %s\n",
+                    strerror(errno));
+            unlink(tmp);
+            return -1;
+        }
+
+        /* Reset the cursor before the rename: a crash between the two
+         * leaves the old journal with a zero cursor, which merely
+         * re-scans acknowledged records — never loses pending ones */
+        if (journal_write_base(events_dir, 0) != 0 ||
+            rename(tmp, jpath) != 0) {
+            fprintf(stderr, "Error: journal compaction failed: %s\n",
+                    strerror(errno));
+            unlink(tmp);
+            return -1;
+        }
+
+        printf("Pruned %d event%s (%.1f KB remaining, %.1f KB limit)\n",
+               pruned, pruned == 1 ? "" : "s",
+               (double)remaining / 1024.0, (double)max_bytes / 1024.0);
+        return 0;
+    }
+
     char processed_dir[BUS_MAX_FULLPATH];
     snprintf(processed_dir, sizeof(processed_dir), "%s/processed", events_dir);
 
@@ -705,6 +1893,19 @@ int bus_prune(const char *events_dir, long long max_bytes)
         return 0;
     }
 
+    /* Fast path: a fresh cache proving we are under budget means the
+     * common hourly no-op prune costs two stats, not one per file.
+     * Deletions never trust the cache — over budget falls through to
+     * the real scan below. */
+    long long sig = proc_stats_sig(events_dir);
+    proc_stats_t ps;
+    if (sig != 0 && proc_stats_load(events_dir, &ps) == 0 &&
+        ps.sig == sig && ps.bytes <= max_bytes) {
+        printf("Pruned 0 events (%.1f KB / %.1f KB limit)\n",
+               (double)ps.bytes / 1024.0, (double)max_bytes / 1024.0);
+        return 0;
+    }
+
     /* Scan processed directory */
     DIR *dir = opendir(processed_dir);
     if (!dir) {
@@ -746,6 +1947,12 @@ int bus_prune(const char *events_dir, long long max_bytes)
     closedir(dir);
 
     if (total_size <= max_bytes) {
+        /* Record what the scan found, signed with the pre-scan mtime so
+         * any concurrent change invalidates the entry */
+        ps.sig = sig;
+        ps.count = count;
+        ps.bytes = total_size;
+        proc_stats_store(events_dir, &ps);
         printf("Pruned 0 events (%.1f KB / %.1f KB limit)\n",
                (double)total_size / 1024.0,
                (double)max_bytes / 1024.0);
@@ -770,6 +1977,11 @@ int bus_prune(const char *events_dir, long long max_bytes)
         }
     }
 
+    ps.sig = proc_stats_sig(events_dir);
+    ps.count = count - pruned;
+    ps.bytes = total_size;
+    proc_stats_store(events_dir, &ps);
+
     printf("Pruned %d event%s (%.1f KB remaining, %.1f KB limit)\n",
            pruned, pruned == 1 ? "" : "s",
            (double)total_size / 1024.0,
@@ -808,30 +2020,44 @@ int bus_status(const char *events_dir)
             oldest_ts = events[i].timestamp_us;
     }
 
-    /* Count processed events and total size */
+    /* Count processed events and total size. processed/ is the
+     * unbounded side (16 MB of small events is tens of thousands of
+     * stat calls), so a fresh cache replaces the whole scan; pending
+     * is bounded and scanned above regardless. */
     char processed_dir[BUS_MAX_FULLPATH];
     snprintf(processed_dir, sizeof(processed_dir), "%s/processed", events_dir);
-    int processed_count = 0;
+    long long processed_count = 0;
     long long processed_size = 0;
 
-    DIR *dir = opendir(processed_dir);
-    if (dir) {
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            const char *name = entry->d_name;
-            size_t nlen = strlen(name);
-            if (nlen < 7 || strcmp(name + nlen - 6, ".event") != 0)
-                continue;
-
-            char fullpath[BUS_MAX_FULLPATH];
-            snprintf(fullpath, sizeof(fullpath), "%s/processed/%s", events_dir, name);
-            struct stat fst;
-            if (stat(fullpath, &fst) == 0 && S_ISREG(fst.st_mode)) {
-                processed_count++;
-                processed_size += fst.st_size;
+    long long psig = proc_stats_sig(events_dir);
+    proc_stats_t ps;
+    if (psig != 0 && proc_stats_load(events_dir, &ps) == 0 && ps.sig == psig) {
+        processed_count = ps.count;
+        processed_size = ps.bytes;
+    } else {
+        DIR *dir = opendir(processed_dir);
+        if (dir) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != NULL) {
+                const char *name = entry->d_name;
+                size_t nlen = strlen(name);
+                if (nlen < 7 || strcmp(name + nlen - 6, ".event") != 0)
+                    continue;
+
+                char fullpath[BUS_MAX_FULLPATH];
+                snprintf(fullpath, sizeof(fullpath), "%s/processed/%s", events_dir, name);
+                struct stat fst;
+                if (stat(fullpath, &fst) == 0 && S_ISREG(fst.st_mode)) {
+                    processed_count++;
+                    processed_size += fst.st_size;
+                }
             }
+            closedir(dir);
         }
-        closedir(dir);
+        ps.sig = psig;
+        ps.count = processed_count;
+        ps.bytes = processed_size;
+        proc_stats_store(events_dir, &ps);
     }
 
     printf("Pending: %d total", count);
@@ -851,12 +2077,22 @@ int bus_status(const char *events_dir)
         printf("Oldest pending: %s\n", oldest_str);
     }
 
-    printf("Processed: %d events (%.1f KB)\n",
+    printf("Processed: %lld events (%.1f KB)\n",
            processed_count, (double)processed_size / 1024.0);
 
     /* Check for stale events if ack-timeout is configured */
     bus_config_t cfg;
     bus_load_config(events_dir, &cfg);
+
+    if (cfg.queue_journal) {
+        char jpath[BUS_MAX_FULLPATH];
+        journal_file_path(events_dir, jpath, sizeof(jpath));
+        struct stat jst;
+        long long jsize = (stat(jpath, &jst) == 0) ? (long long)jst.st_size : 0;
+        printf("Journal: %.1f KB (%.1f KB consumed)\n",
+               (double)jsize / 1024.0,
+               (double)journal_read_base(events_dir) / 1024.0);
+    }
     if (cfg.ack_timeout_s > 0 && count > 0) {
         long long current_us = now_us();
         long long timeout_us = cfg.ack_timeout_s * 1000000LL;
@@ -874,6 +2110,100 @@ int bus_status(const char *events_dir)
     return 0;
 }
 
+/* ------------------------------------------------------------------ */
+/* Dedup ledger                                                        */
+/*                                                                     */
+/* events_dir/.dedup caches the most recent publish per dedup key:     */
+/*                                                                     */
+/*   <source>:<type> <timestamp-us> <filename>                         */
+/*                                                                     */
+/* bus_publish_dedup consults it before falling back to the directory  */
+/* scan: a fresh entry whose event file is still pending proves a      */
+/* duplicate with one stat instead of O(pending) file reads. The       */
+/* ledger is only trusted for positive answers — a missing or stale    */
+/* entry still scans — so a lost or pruned ledger can never let a      */
+/* duplicate through that the scan would have caught. Entries are      */
+/* pruned on rewrite (age and count caps); pruning just means one      */
+/* extra scan, never a wrong answer.                                   */
+/* ------------------------------------------------------------------ */
+
+#define BUS_DEDUP_LEDGER_FILE     ".dedup"
+#define BUS_DEDUP_LEDGER_MAX      256
+#define BUS_DEDUP_LEDGER_MAX_AGE  (3600LL * 1000000LL)  /* 1 hour in us */
+
+typedef struct {
+    char key[BUS_MAX_HANDLE + BUS_MAX_TYPE + 2];
+    long long ts_us;
+    char filename[BUS_MAX_FILENAME];
+} dedup_entry_t;
+
+static void dedup_ledger_path(const char *events_dir, char *buf, size_t len)
+{
+    snprintf(buf, len, "%s/%s", events_dir, BUS_DEDUP_LEDGER_FILE);
+}
+
+/* Load the ledger; malformed lines are skipped. Returns the count. */
+static int dedup_ledger_load(const char *events_dir, dedup_entry_t *entries,
+                             int max_entries)
+{
+    char path[BUS_MAX_FULLPATH];
+    dedup_ledger_path(events_dir, path, sizeof(path));
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+
+    int count = 0;
+    char line[sizeof(((dedup_entry_t *)0)->key) + BUS_MAX_FILENAME + 32];
+    while (count < max_entries && fgets(line, sizeof(line), fp)) {
+        dedup_entry_t *e = &entries[count];
+        if (sscanf(line, "%257s %lld %511s",
+                   e->key, &e->ts_us, e->filename) == 3 && e->ts_us > 0)
+            count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+/* Newest first, for the count cap */
+static int dedup_entry_compare(const void *a, const void *b)
+{
+    const dedup_entry_t *ea = (const dedup_entry_t *)a;
+    const dedup_entry_t *eb = (const dedup_entry_t *)b;
+    if (ea->ts_us > eb->ts_us) return -1;
+    if (ea->ts_us < eb->ts_us) return  1;
+    return 0;
+}
+
+/* Rewrite the ledger (temp + rename), pruning aged-out entries and
+ * capping the count. Best effort: a failed write just means the next
+ * dedup publish scans. */
+static void dedup_ledger_store(const char *events_dir, dedup_entry_t *entries,
+                               int count)
+{
+    long long horizon = now_us() - BUS_DEDUP_LEDGER_MAX_AGE;
+
+    qsort(entries, (size_t)count, sizeof(dedup_entry_t), dedup_entry_compare);
+    if (count > BUS_DEDUP_LEDGER_MAX)
+        count = BUS_DEDUP_LEDGER_MAX;
+
+    char path[BUS_MAX_FULLPATH];
+    char tmp[BUS_MAX_FULLPATH];
+    dedup_ledger_path(events_dir, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s/.tmp-dedup-%d", events_dir, (int)getpid());
+
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return;
+    for (int i = 0; i < count; i++) {
+        if (entries[i].ts_us < horizon)
+            continue;
+        if (fprintf(fp, "%s %lld %s\n", entries[i].key, entries[i].ts_us,
+                    entries[i].filename) < 0)
+            break;
+    }
+    if (fclose(fp) != 0 || rename(tmp, path) != 0)
+        unlink(tmp);
+}
+
 int bus_publish_dedup(const char *events_dir, const char *source,
                       const char *type, int priority, const char *payload,
                       long long dedup_window_us)
@@ -891,10 +2221,78 @@ int bus_publish_dedup(const char *events_dir, const char *source,
     long long current_us = now_us();
     long long cutoff_us = current_us - dedup_window_us;
 
+    if (journal_mode(events_dir)) {
+        /* Pending journal records carry source/type, which is the dedup
+         * key — one cursor seek instead of a directory of file reads */
+        bus_event_t *events = malloc(sizeof(bus_event_t) * BUS_MAX_EVENTS);
+        if (!events) {
+            fprintf(stderr, "Error: out of memory scanning journal\n");
+            return -1;
+        }
+        int count = journal_scan(events_dir, events, BUS_MAX_EVENTS, NULL);
+        if (count < 0) {
+            free(events);
+            fprintf(stderr, "Error: cannot scan journal\n");
+            return -1;
+        }
+        int dup = 0;
+        for (int i = 0; i < count; i++) {
+            if (events[i].timestamp_us < cutoff_us)
+                continue;
+            char key[BUS_MAX_HANDLE + BUS_MAX_TYPE + 2];
+            snprintf(key, sizeof(key), "%s:%s",
+                     events[i].source, events[i].type);
+            if (strcmp(proposed_key, key) == 0) {
+                dup = 1;
+                break;
+            }
+        }
+        free(events);
+        if (dup) {
+            fprintf(stderr, "Dedup: event %s dropped (duplicate within window)\n",
+                    proposed_key);
+            return BUS_EXIT_DEDUP;
+        }
+        return bus_publish(events_dir, source, type, priority, payload);
+    }
+
+    /* Ledger fast path: a fresh entry whose event file is still pending
+     * proves the duplicate with one stat — no queue scan. Absent or
+     * stale entries fall through to the scan below, so the ledger can
+     * only save work, never miss a duplicate the scan would catch. */
+    dedup_entry_t *ledger =
+        malloc(sizeof(dedup_entry_t) * (BUS_DEDUP_LEDGER_MAX + 1));
+    int ledger_count = 0;
+    int ledger_hit = -1; /* index of our key, if present */
+    if (ledger) {
+        ledger_count = dedup_ledger_load(events_dir, ledger,
+                                         BUS_DEDUP_LEDGER_MAX);
+        for (int i = 0; i < ledger_count; i++) {
+            if (strcmp(ledger[i].key, proposed_key) == 0) {
+                ledger_hit = i;
+                break;
+            }
+        }
+        if (ledger_hit >= 0 && ledger[ledger_hit].ts_us >= cutoff_us) {
+            char evpath[BUS_MAX_FULLPATH];
+            snprintf(evpath, sizeof(evpath), "%s/%s", events_dir,
+                     ledger[ledger_hit].filename);
+            struct stat est;
+            if (stat(evpath, &est) == 0 && S_ISREG(est.st_mode)) {
+                free(ledger);
+                fprintf(stderr, "Dedup: event %s dropped (duplicate within window)\n",
+                        proposed_key);
+                return BUS_EXIT_DEDUP;
+            }
+            /* Event was acknowledged — the window no longer applies */
+        }
+    }
+
     /* Scan pending events directory for duplicates */
     DIR *dir = opendir(events_dir);
     if (!dir) {
         /* Directory doesn't exist — proceed to publish (it will fail there) */
+        free(ledger);
         return bus_publish(events_dir, source, type, priority, payload);
     }
 
@@ -938,10 +2336,105 @@ int bus_publish_dedup(const char *events_dir, const char *source,
     closedir(dir);
 
     if (duplicate_found) {
+        free(ledger);
         fprintf(stderr, "Dedup: event %s dropped (duplicate within window)\n",
                 proposed_key);
         return BUS_EXIT_DEDUP;
     }
 
-    return bus_publish(events_dir, source, type, priority, payload);
+    /* Publish through the internals so we learn the filename and can
+     * record this key in the ledger for the next heartbeat */
+    if (publish_validate(source, type, priority) != 0 ||
+        publish_dir_ready(events_dir) != 0) {
+        free(ledger);
+        return -1;
+    }
+    long long ts_us = now_us();
+    char filename[BUS_MAX_FILENAME];
+    if (publish_one(events_dir, source, type, priority, payload,
+                    ts_us, filename) != 0) {
+        free(ledger);
+        return -1;
+    }
+    if (!g_quiet)
+        printf("%s\n", filename);
+
+    if (ledger) {
+        dedup_entry_t *e = (ledger_hit >= 0) ? &ledger[ledger_hit]
+                                             : &ledger[ledger_count++];
+        snprintf(e->key, sizeof(e->key), "%s", proposed_key);
+        e->ts_us = ts_us;
+        snprintf(e->filename, sizeof(e->filename), "%s", filename);
+        dedup_ledger_store(events_dir, ledger, ledger_count);
+        free(ledger);
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Processed-size cache                                                */
+/*                                                                     */
+/* events_dir/.stats caches the processed/ totals that bus_status and  */
+/* bus_prune would otherwise recompute with one stat per file:         */
+/*                                                                     */
+/*   processed-sig: <mtime-ns>                                         */
+/*   processed-count: <n>                                              */
+/*   processed-bytes: <n>                                              */
+/*                                                                     */
+/* The signature is the processed/ directory mtime at the moment the   */
+/* counts were taken; any ack, prune or manual change bumps the mtime  */
+/* and invalidates the entry, so no code path has to remember to clear */
+/* it. A stale or missing cache just means one full scan — it can      */
+/* save work but never change an answer, and prune only uses it to     */
+/* skip the scan when already under budget, never to pick deletions.   */
+/* The file is rewritten in place (not temp + rename) because a rename */
+/* into events_dir would perturb directory mtimes; a torn write fails  */
+/* to parse and is treated as a miss.                                  */
+/* ------------------------------------------------------------------ */
+
+#define BUS_STATS_FILE ".stats"
+
+static long long proc_stats_sig(const char *events_dir)
+{
+    char path[BUS_MAX_FULLPATH];
+    snprintf(path, sizeof(path), "%s/processed", events_dir);
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode))
+        return 0;
+    return (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+static int proc_stats_load(const char *events_dir, proc_stats_t *s)
+{
+    char path[BUS_MAX_FULLPATH];
+    snprintf(path, sizeof(path), "%s/%s", events_dir, BUS_STATS_FILE);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    int got = fscanf(fp,
+                     "processed-sig: %lld\nprocessed-count: %lld\n"
+                     "processed-bytes: %lld\n",
+                     &s->sig, &s->count, &s->bytes);
+    fclose(fp);
+    if (got != 3 || s->sig == 0 || s->count < 0 || s->bytes < 0)
+        return -1;
+    return 0;
+}
+
+static void proc_stats_store(const char *events_dir, const proc_stats_t *s)
+{
+    if (s->sig == 0)
+        return;
+
+    char path[BUS_MAX_FULLPATH];
+    snprintf(path, sizeof(path), "%s/%s", events_dir, BUS_STATS_FILE);
+
+    /* Best effort: the cache is rebuilt from a scan whenever absent */
+    FILE *fp = fopen(path, "w");
+    if (!fp) return;
+    fprintf(fp, "processed-sig: %lld\nprocessed-count: %lld\n"
+                "processed-bytes: %lld\n",
+            s->sig, s->count, s->bytes);
+    fclose(fp);
 }
@@ -16,6 +16,13 @@
  *
  * Events flow: publish -> queue -> check -> read -> ack (move to processed/)
  *
+ * Opt-in journal mode (config.yaml `queue-format: journal`) replaces the
+ * one-file-per-event queue with a single append-only journal of
+ * length-prefixed records; acks flip a per-record flag and advance a
+ * consumed-offset cursor instead of moving files. Publish becomes one
+ * append and check one seek past the cursor. The public API and output
+ * formats are unchanged — event "filenames" are virtual in journal mode.
+ *
  * Invariants (enforced by ASSERT_MSG):
  *   - priority is one of: critical(0), high(1), normal(2), low(3)
  *   - event filenames match the naming convention
@@ -73,12 +80,18 @@
 #define BUS_DEFAULT_MAX_BYTES      (16LL * 1024 * 1024)  /* 16 MB */
 #define BUS_DEFAULT_DEDUP_WINDOW   0                      /* disabled */
 #define BUS_DEFAULT_ACK_TIMEOUT    0                      /* disabled */
+#define BUS_DEFAULT_QUEUE_JOURNAL  0                      /* one file per event */
+
+/* Journal mode on-disk names (inside the events directory) */
+#define BUS_JOURNAL_FILE     "journal"
+#define BUS_JOURNAL_BASE_FILE "journal.base"
 
 /* Bus configuration (loaded from config.yaml) */
 typedef struct {
     long long retention_max_bytes;  /* max bytes in processed/ before pruning */
     long long dedup_window_s;      /* default dedup window in seconds (0 = disabled) */
     long long ack_timeout_s;       /* stale event threshold in seconds (0 = disabled) */
+    int queue_journal;             /* 1 = single append journal, 0 = one file per event */
 } bus_config_t;
 
 /*
@@ -88,6 +101,7 @@ typedef struct {
  *   retention-max-bytes: <integer>
  *   dedup-window: <integer seconds>
  *   ack-timeout: <integer seconds>  (0 = disabled)
+ *   queue-format: <files|journal>   (default files)
  *
  * Unrecognised keys are silently ignored. Missing file or missing keys
  * use defaults. Invalid values are ignored (default used).
@@ -132,6 +146,17 @@ int bus_priority_from_str(const char *s);
  */
 const char *bus_priority_to_str(int p);
 
+/*
+ * bus_set_quiet — Suppress the filename print on successful publish.
+ *
+ * The CLI prints each published event's filename to stdout so scripts
+ * can capture it. In-process callers (e.g. the nbs-chat bus bridge,
+ * which links libnbs-bus.a) must not mix event filenames into their
+ * own stdout; they call bus_set_quiet(1) once before publishing.
+ * Error reporting to stderr is unaffected.
+ */
+void bus_set_quiet(int quiet);
+
 /*
  * bus_publish — Create an event file atomically.
  *
@@ -152,6 +177,64 @@ const char *bus_priority_to_str(int p);
 int bus_publish(const char *events_dir, const char *source, const char *type,
                 int priority, const char *payload);
 
+/*
+ * bus_publish_stream — Publish one event with its payload read from a
+ * stream.
+ *
+ * Preconditions:
+ *   - Same as bus_publish, but the payload comes from payload_fp
+ *     (read to EOF) instead of a string; payload_fp != NULL
+ *
+ * Postconditions (on success, return 0):
+ *   - Same as bus_publish; an empty stream publishes the event with no
+ *     payload section, and a missing final newline is supplied
+ *
+ * Directory mode copies the stream straight into the event file in
+ * fixed-size chunks, so payload size is disk-bound and memory use is
+ * constant. Journal mode must frame the record with its length and
+ * append it in a single write, so the payload is staged once in heap —
+ * still free of argv limits, but payload-sized.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int bus_publish_stream(const char *events_dir, const char *source,
+                       const char *type, int priority, FILE *payload_fp);
+
+/* One event in a batch publish request.
+ *
+ * Fields are borrowed pointers — bus_publish_batch reads them during
+ * the call and does not retain them. payload may be NULL.
+ */
+typedef struct {
+    const char *source;
+    const char *type;
+    int priority;           /* BUS_PRIORITY_* */
+    const char *payload;    /* may be NULL (omitted from event file) */
+} bus_batch_event_t;
+
+/*
+ * bus_publish_batch — Publish several events with one metadata flush.
+ *
+ * Preconditions:
+ *   - events_dir != NULL, points to an existing .nbs/events/ directory
+ *   - events != NULL, n > 0
+ *   - each event's source/type non-empty, no whitespace; priority in [0, 3]
+ *
+ * Postconditions (on success, return 0):
+ *   - n new .event files exist in events_dir, each created atomically
+ *     (write-temp, rename) with strictly increasing timestamps
+ *   - The events directory has been fsync'd exactly once, making all
+ *     n renames durable — N events cost one metadata flush, not N
+ *   - Filenames printed to stdout (unless bus_set_quiet)
+ *
+ * The batch is not transactional: a failure part way through leaves
+ * the earlier events published and returns -1.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int bus_publish_batch(const char *events_dir, const bus_batch_event_t *events,
+                      int n);
+
 /*
  * bus_publish_dedup — Publish with deduplication.
  *
@@ -188,6 +271,29 @@ int bus_publish_dedup(const char *events_dir, const char *source,
  */
 int bus_check(const char *events_dir, const char *handle);
 
+/*
+ * bus_wait — Block until a pending event matches, then print it.
+ *
+ * Preconditions:
+ *   - events_dir != NULL, points to an existing .nbs/events/ directory
+ *   - handle may be NULL (any source matches)
+ *   - timeout_secs >= 0 (zero means return immediately after one check)
+ *
+ * Postconditions:
+ *   - Returns 0: at least one matching pending event existed or arrived;
+ *     all matching events printed in bus_check format
+ *   - Returns BUS_EXIT_NOT_FOUND (3): timeout_secs elapsed with no match
+ *   - Returns -1: error
+ *
+ * On Linux this blocks in the kernel on an inotify watch of the events
+ * directory and re-scans only when a .event file actually lands, waking
+ * within milliseconds of a publish. If inotify is unavailable it falls
+ * back to re-scanning once per second.
+ *
+ * Returns 0 if an event matched, 3 on timeout, -1 on error.
+ */
+int bus_wait(const char *events_dir, const char *handle, int timeout_secs);
+
 /*
  * bus_read — Read and display a single event file.
  *
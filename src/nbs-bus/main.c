@@ -31,12 +31,27 @@ static void print_usage(void)
         "      --dedup-window=N: drop if same source:type exists within N seconds.\n"
         "                        Default: 0 (disabled), or from config.yaml.\n"
         "                        Exit code 5 when deduplicated.\n"
+        "      --payload-stdin:  read the payload from stdin instead of argv,\n"
+        "                        streamed in constant memory (no size limit).\n"
+        "                        Cannot be combined with --dedup-window.\n"
+        "\n"
+        "  publish-batch <dir> <source> <type> <priority> <payload> [<type> <priority> <payload> ...]\n"
+        "      Write several events, then fsync the queue directory once.\n"
+        "      Events share the source; each needs a type, priority and payload\n"
+        "      (use '' for no payload). All-or-nothing validation, but a mid-\n"
+        "      batch I/O error leaves earlier events published.\n"
         "\n"
         "  check <dir> [--handle=<name>]\n"
         "      List pending events, highest priority first.\n"
         "      Output: [priority] filename (age)\n"
         "      --handle=<name>: show only events from this source.\n"
         "\n"
+        "  wait <dir> [--handle=<name>] [--timeout=N]\n"
+        "      Block until a matching event is pending, then print it\n"
+        "      in check format. Timeout default: 10 seconds.\n"
+        "      --handle=<name>: wait only for events from this source.\n"
+        "      Exit code 3 on timeout.\n"
+        "\n"
         "  read <dir> <event-file>\n"
         "      Read a single event file.\n"
         "\n"
@@ -202,6 +217,16 @@ static int cmd_publish(int argc, char **argv)
     if (argc > 6 && strncmp(argv[6], "--", 2) != 0)
         payload = argv[6];
 
+    int payload_stdin = 0;
+    for (int i = 6; i < argc; i++) {
+        if (strcmp(argv[i], "--payload-stdin") == 0)
+            payload_stdin = 1;
+    }
+    if (payload_stdin && payload != NULL) {
+        fprintf(stderr, "Error: --payload-stdin cannot be combined with a payload argument\n");
+        return BUS_EXIT_BAD_ARGS;
+    }
+
     int rc = verify_events_dir(dir);
     if (rc != 0) return rc;
 
@@ -229,6 +254,18 @@ static int cmd_publish(int argc, char **argv)
     if (dedup_window_us < 0)
         return BUS_EXIT_BAD_ARGS;
 
+    if (payload_stdin) {
+        /* Dedup scans happen before the payload exists, and stdin can
+         * only be consumed once — keep the two modes separate */
+        if (dedup_window_us > 0) {
+            fprintf(stderr, "Error: --payload-stdin cannot be combined with --dedup-window\n");
+            return BUS_EXIT_BAD_ARGS;
+        }
+        if (bus_publish_stream(dir, source, type, priority, stdin) != 0)
+            return BUS_EXIT_ERROR;
+        return BUS_EXIT_OK;
+    }
+
     if (dedup_window_us > 0) {
         rc = bus_publish_dedup(dir, source, type, priority, payload, dedup_window_us);
         if (rc == BUS_EXIT_DEDUP)
@@ -244,6 +281,119 @@ static int cmd_publish(int argc, char **argv)
     return BUS_EXIT_OK;
 }
 
+/* Largest batch accepted on the command line. Generous: the chat bridge
+ * batches one chat-message plus at most MAX_MENTIONS mention events. */
+#define MAX_BATCH_EVENTS 128
+
+static int cmd_publish_batch(int argc, char **argv)
+{
+    /* nbs-bus publish-batch <dir> <source> <type> <priority> <payload> [...] */
+    if (argc < 7) {
+        fprintf(stderr, "Usage: nbs-bus publish-batch <dir> <source> "
+                        "<type> <priority> <payload> "
+                        "[<type> <priority> <payload> ...]\n");
+        return BUS_EXIT_BAD_ARGS;
+    }
+
+    const char *dir = argv[2];
+    const char *source = argv[3];
+
+    if (validate_non_empty_no_whitespace(source, "source") != 0)
+        return BUS_EXIT_BAD_ARGS;
+
+    int remaining = argc - 4;
+    if (remaining % 3 != 0) {
+        fprintf(stderr, "Error: events must be <type> <priority> <payload> "
+                        "triples (%d trailing argument%s)\n",
+                remaining % 3, (remaining % 3 == 1) ? "" : "s");
+        return BUS_EXIT_BAD_ARGS;
+    }
+
+    int n = remaining / 3;
+    if (n > MAX_BATCH_EVENTS) {
+        fprintf(stderr, "Error: batch too large (%d events, max %d)\n",
+                n, MAX_BATCH_EVENTS);
+        return BUS_EXIT_BAD_ARGS;
+    }
+
+    bus_batch_event_t events[MAX_BATCH_EVENTS];
+    for (int i = 0; i < n; i++) {
+        const char *type = argv[4 + i * 3];
+        const char *priority_str = argv[5 + i * 3];
+        const char *payload = argv[6 + i * 3];
+
+        if (validate_non_empty_no_whitespace(type, "type") != 0)
+            return BUS_EXIT_BAD_ARGS;
+        int priority = bus_priority_from_str(priority_str);
+        if (priority < 0) {
+            fprintf(stderr, "Error: invalid priority '%s' (use: critical, "
+                            "high, normal, low)\n", priority_str);
+            return BUS_EXIT_BAD_ARGS;
+        }
+
+        events[i].source = source;
+        events[i].type = type;
+        events[i].priority = priority;
+        events[i].payload = (payload[0] != '\0') ? payload : NULL;
+    }
+
+    int rc = verify_events_dir(dir);
+    if (rc != 0) return rc;
+
+    if (bus_publish_batch(dir, events, n) != 0)
+        return BUS_EXIT_ERROR;
+
+    return BUS_EXIT_OK;
+}
+
+/* Parse --timeout=<seconds> from argv. Returns value, or default_secs
+ * if not specified, or -1 on an invalid value. */
+static int parse_timeout_opt(int argc, char **argv, int start, int default_secs)
+{
+    ASSERT_MSG(argv != NULL, "parse_timeout_opt: argv is NULL");
+    ASSERT_MSG(start >= 0 && start <= argc,
+               "parse_timeout_opt: start %d out of range [0, %d]", start, argc);
+    for (int i = start; i < argc; i++) {
+        if (strncmp(argv[i], "--timeout=", 10) == 0) {
+            const char *s = argv[i] + 10;
+            char *endp;
+            errno = 0;
+            long val = strtol(s, &endp, 10);
+            if (errno != 0 || *endp != '\0' || val < 0 || val > INT_MAX) {
+                fprintf(stderr, "Error: invalid --timeout value: %s\n", s);
+                return -1;
+            }
+            return (int)val;
+        }
+    }
+    return default_secs;
+}
+
+static int cmd_wait(int argc, char **argv)
+{
+    /* nbs-bus wait <dir> [--handle=<name>] [--timeout=N] */
+    if (argc < 3) {
+        fprintf(stderr, "Usage: nbs-bus wait <dir> [--handle=<name>] [--timeout=N]\n");
+        return BUS_EXIT_BAD_ARGS;
+    }
+
+    const char *dir = argv[2];
+    int rc = verify_events_dir(dir);
+    if (rc != 0) return rc;
+
+    const char *handle = parse_handle_opt(argc, argv, 3);
+    int timeout_secs = parse_timeout_opt(argc, argv, 3, 10);
+    if (timeout_secs < 0)
+        return BUS_EXIT_BAD_ARGS;
+
+    rc = bus_wait(dir, handle, timeout_secs);
+    if (rc == BUS_EXIT_NOT_FOUND)
+        return BUS_EXIT_NOT_FOUND; /* Timeout */
+    if (rc != 0)
+        return BUS_EXIT_ERROR;
+    return BUS_EXIT_OK;
+}
+
 static int cmd_check(int argc, char **argv)
 {
     /* nbs-bus check <dir> [--handle=<name>] */
@@ -394,7 +544,9 @@ int main(int argc, char **argv)
     const char *cmd = argv[1];
 
     if (strcmp(cmd, "publish") == 0)  return cmd_publish(argc, argv);
+    if (strcmp(cmd, "publish-batch") == 0) return cmd_publish_batch(argc, argv);
     if (strcmp(cmd, "check") == 0)    return cmd_check(argc, argv);
+    if (strcmp(cmd, "wait") == 0)     return cmd_wait(argc, argv);
     if (strcmp(cmd, "read") == 0)     return cmd_read(argc, argv);
     if (strcmp(cmd, "ack") == 0)      return cmd_ack(argc, argv);
     if (strcmp(cmd, "ack-all") == 0)  return cmd_ack_all(argc, argv);
@@ -14,6 +14,15 @@
 #include "chat_file.h"
 #include <assert.h>
 #include <limits.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define BASE64_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
 
 static const char encode_table[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
@@ -87,6 +96,378 @@ static const unsigned char decode_table[256] = {
 };
 /* clang-format on */
 
+/*
+ * --- Vectorized bulk kernels ---
+ *
+ * base64_encode/base64_decode hand the bulk of their input to these
+ * kernels and finish the remainder (final groups, padding) with the
+ * scalar loops below. The kernels are pure fast paths:
+ *
+ *   - They only consume whole vector-width groups; everything they
+ *     consume is fully encoded/decoded and, for decode, fully
+ *     validated. They never write past the bytes they account for.
+ *   - The decode kernels stop at the first chunk containing any byte
+ *     outside the core alphabet (including '='), so padding handling
+ *     and the detailed per-character error reporting stay in the
+ *     scalar code with its exact messages.
+ *
+ * On x86 the SSSE3 and AVX2 variants are selected at runtime with
+ * __builtin_cpu_supports (compiled via function-level target attributes,
+ * so no build-flag changes). On AArch64 NEON is architecturally
+ * guaranteed, so no probe is needed. Anything else gets the scalar
+ * loops unchanged.
+ */
+
+#ifdef BASE64_SIMD_X86
+
+/* Runtime ISA probe, resolved once. The benign race on first use is
+ * harmless: every thread computes the same value. */
+static int b64_cpu_level(void) {
+    static int level = -1; /* -1 unprobed; 0 scalar, 1 SSSE3, 2 AVX2 */
+    if (level < 0) {
+        int l = 0;
+        if (__builtin_cpu_supports("ssse3")) l = 1;
+        if (__builtin_cpu_supports("avx2")) l = 2;
+        level = l;
+    }
+    return level;
+}
+
+/*
+ * Encode: 12 input bytes -> 16 output chars per step. The shuffle
+ * spreads each 3-byte group across a 32-bit lane as [b1 b0 b2 b1];
+ * the mulhi/mullo pair then shifts the four sextets into separate
+ * bytes (Muła's algorithm). Sextets become ASCII by adding a
+ * per-class offset looked up from a 13-entry table indexed by
+ * saturating-subtract: 0->'a' class (+71), 1..10 digits (-4),
+ * 11 '+' (-19), 12 '/' (-16), 13 'A' class (+65).
+ */
+__attribute__((target("ssse3")))
+static size_t encode_bulk_ssse3(const unsigned char *input, size_t input_len,
+                                char *output) {
+    size_t i = 0, j = 0;
+    const __m128i shuf = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                      4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i lut = _mm_setr_epi8(71, -4, -4, -4, -4, -4, -4, -4,
+                                      -4, -4, -4, -19, -16, 65, 0, 0);
+
+    /* Loads 16 bytes per step but consumes 12, so stop 16 short */
+    while (i + 16 <= input_len) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(input + i));
+        in = _mm_shuffle_epi8(in, shuf);
+
+        const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+        const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+        const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        const __m128i indices = _mm_or_si128(t1, t3);
+
+        __m128i cls = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        const __m128i is_upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        cls = _mm_or_si128(cls, _mm_and_si128(is_upper, _mm_set1_epi8(13)));
+        const __m128i ascii =
+            _mm_add_epi8(_mm_shuffle_epi8(lut, cls), indices);
+
+        _mm_storeu_si128((__m128i *)(output + j), ascii);
+        i += 12;
+        j += 16;
+    }
+    return i;
+}
+
+/* AVX2 encode: the SSSE3 step run on two independent 12-byte groups
+ * per iteration, one per 128-bit lane (shuffle_epi8 is lane-local). */
+__attribute__((target("avx2")))
+static size_t encode_bulk_avx2(const unsigned char *input, size_t input_len,
+                               char *output) {
+    size_t i = 0, j = 0;
+    const __m256i shuf = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                         4, 5, 3, 4, 1, 2, 0, 1,
+                                         10, 11, 9, 10, 7, 8, 6, 7,
+                                         4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i lut = _mm256_setr_epi8(71, -4, -4, -4, -4, -4, -4, -4,
+                                         -4, -4, -4, -19, -16, 65, 0, 0,
+                                         71, -4, -4, -4, -4, -4, -4, -4,
+                                         -4, -4, -4, -19, -16, 65, 0, 0);
+
+    /* Second lane loads 16 bytes from i+12, so stop 28 short */
+    while (i + 28 <= input_len) {
+        __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(
+                _mm_loadu_si128((const __m128i *)(input + i))),
+            _mm_loadu_si128((const __m128i *)(input + i + 12)), 1);
+        in = _mm256_shuffle_epi8(in, shuf);
+
+        const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i cls = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i is_upper =
+            _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        cls = _mm256_or_si256(cls, _mm256_and_si256(is_upper,
+                                                    _mm256_set1_epi8(13)));
+        const __m256i ascii =
+            _mm256_add_epi8(_mm256_shuffle_epi8(lut, cls), indices);
+
+        _mm256_storeu_si256((__m256i *)(output + j), ascii);
+        i += 24;
+        j += 32;
+    }
+    return i;
+}
+
+/*
+ * Decode: 16 input chars -> 12 output bytes per step. Character
+ * classes are detected with unsigned range compares; any byte outside
+ * the core alphabet (including '=') stops the kernel so the scalar
+ * code can report it. Valid bytes become sextets by adding the class
+ * offset, then maddubs/madd merge the four sextets of each group into
+ * a 24-bit value and a shuffle packs the groups tail-to-head.
+ */
+__attribute__((target("ssse3")))
+static size_t decode_bulk_ssse3(const char *input, size_t input_len,
+                                unsigned char *output) {
+    size_t i = 0, j = 0;
+    const __m128i pack_shuf = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                            14, 13, 12, -1, -1, -1, -1);
+
+    while (i + 16 <= input_len) {
+        const __m128i in = _mm_loadu_si128((const __m128i *)(input + i));
+
+        /* ge(a,b) unsigned: max(a,b) == a */
+        const __m128i cA = _mm_set1_epi8('A'), cZ = _mm_set1_epi8('Z');
+        const __m128i ca = _mm_set1_epi8('a'), cz = _mm_set1_epi8('z');
+        const __m128i c0 = _mm_set1_epi8('0'), c9 = _mm_set1_epi8('9');
+        const __m128i m_up = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_max_epu8(in, cA), in),
+            _mm_cmpeq_epi8(_mm_max_epu8(cZ, in), cZ));
+        const __m128i m_lo = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_max_epu8(in, ca), in),
+            _mm_cmpeq_epi8(_mm_max_epu8(cz, in), cz));
+        const __m128i m_di = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_max_epu8(in, c0), in),
+            _mm_cmpeq_epi8(_mm_max_epu8(c9, in), c9));
+        const __m128i m_pl = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+        const __m128i m_sl = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+
+        const __m128i valid = _mm_or_si128(
+            _mm_or_si128(_mm_or_si128(m_up, m_lo), m_di),
+            _mm_or_si128(m_pl, m_sl));
+        if (_mm_movemask_epi8(valid) != 0xFFFF) break;
+
+        __m128i delta = _mm_and_si128(m_up, _mm_set1_epi8(-65));
+        delta = _mm_or_si128(delta, _mm_and_si128(m_lo, _mm_set1_epi8(-71)));
+        delta = _mm_or_si128(delta, _mm_and_si128(m_di, _mm_set1_epi8(4)));
+        delta = _mm_or_si128(delta, _mm_and_si128(m_pl, _mm_set1_epi8(19)));
+        delta = _mm_or_si128(delta, _mm_and_si128(m_sl, _mm_set1_epi8(16)));
+        const __m128i vals = _mm_add_epi8(in, delta);
+
+        const __m128i merged16 =
+            _mm_maddubs_epi16(vals, _mm_set1_epi32(0x01400140));
+        const __m128i merged32 =
+            _mm_madd_epi16(merged16, _mm_set1_epi32(0x00011000));
+        const __m128i packed = _mm_shuffle_epi8(merged32, pack_shuf);
+
+        unsigned char tmp[16];
+        _mm_storeu_si128((__m128i *)tmp, packed);
+        memcpy(output + j, tmp, 12);
+        i += 16;
+        j += 12;
+    }
+    return i;
+}
+
+/* AVX2 decode: the SSSE3 step on two lanes; each lane packs its 12
+ * bytes independently and the stores are peeled apart per lane. */
+__attribute__((target("avx2")))
+static size_t decode_bulk_avx2(const char *input, size_t input_len,
+                               unsigned char *output) {
+    size_t i = 0, j = 0;
+    const __m256i pack_shuf = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    while (i + 32 <= input_len) {
+        const __m256i in = _mm256_loadu_si256((const __m256i *)(input + i));
+
+        const __m256i cA = _mm256_set1_epi8('A'), cZ = _mm256_set1_epi8('Z');
+        const __m256i ca = _mm256_set1_epi8('a'), cz = _mm256_set1_epi8('z');
+        const __m256i c0 = _mm256_set1_epi8('0'), c9 = _mm256_set1_epi8('9');
+        const __m256i m_up = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_max_epu8(in, cA), in),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(cZ, in), cZ));
+        const __m256i m_lo = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_max_epu8(in, ca), in),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(cz, in), cz));
+        const __m256i m_di = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_max_epu8(in, c0), in),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(c9, in), c9));
+        const __m256i m_pl = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+        const __m256i m_sl = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+
+        const __m256i valid = _mm256_or_si256(
+            _mm256_or_si256(_mm256_or_si256(m_up, m_lo), m_di),
+            _mm256_or_si256(m_pl, m_sl));
+        if (_mm256_movemask_epi8(valid) != -1) break;
+
+        __m256i delta = _mm256_and_si256(m_up, _mm256_set1_epi8(-65));
+        delta = _mm256_or_si256(delta,
+                                _mm256_and_si256(m_lo, _mm256_set1_epi8(-71)));
+        delta = _mm256_or_si256(delta,
+                                _mm256_and_si256(m_di, _mm256_set1_epi8(4)));
+        delta = _mm256_or_si256(delta,
+                                _mm256_and_si256(m_pl, _mm256_set1_epi8(19)));
+        delta = _mm256_or_si256(delta,
+                                _mm256_and_si256(m_sl, _mm256_set1_epi8(16)));
+        const __m256i vals = _mm256_add_epi8(in, delta);
+
+        const __m256i merged16 =
+            _mm256_maddubs_epi16(vals, _mm256_set1_epi32(0x01400140));
+        const __m256i merged32 =
+            _mm256_madd_epi16(merged16, _mm256_set1_epi32(0x00011000));
+        const __m256i packed = _mm256_shuffle_epi8(merged32, pack_shuf);
+
+        unsigned char tmp[32];
+        _mm256_storeu_si256((__m256i *)tmp, packed);
+        memcpy(output + j, tmp, 12);
+        memcpy(output + j + 12, tmp + 16, 12);
+        i += 32;
+        j += 24;
+    }
+    return i;
+}
+
+/* Bulk dispatchers: AVX2 first when available, SSSE3 mops up the
+ * sub-AVX2 remainder, the scalar loops take whatever is left.
+ * Both return the number of input bytes fully consumed. */
+static size_t base64_encode_bulk(const unsigned char *input, size_t input_len,
+                                 char *output) {
+    const int level = b64_cpu_level();
+    size_t i = 0;
+    if (level >= 2) i = encode_bulk_avx2(input, input_len, output);
+    if (level >= 1) {
+        i += encode_bulk_ssse3(input + i, input_len - i,
+                               output + (i / 3) * 4);
+    }
+    return i;
+}
+
+static size_t base64_decode_bulk(const char *input, size_t input_len,
+                                 unsigned char *output) {
+    const int level = b64_cpu_level();
+    size_t i = 0;
+    if (level >= 2) i = decode_bulk_avx2(input, input_len, output);
+    if (level >= 1) {
+        i += decode_bulk_ssse3(input + i, input_len - i,
+                               output + (i / 4) * 3);
+    }
+    return i;
+}
+
+#endif /* BASE64_SIMD_X86 */
+
+#ifdef BASE64_SIMD_NEON
+
+/* Encode: 48 input bytes -> 64 output chars per step. vld3q
+ * deinterleaves the 3-byte groups across three registers, the sextets
+ * fall out of shifts/masks, a 64-byte table lookup (vqtbl4q) maps them
+ * to ASCII, and vst4q interleaves the four output streams back. */
+static size_t encode_bulk_neon(const unsigned char *input, size_t input_len,
+                               char *output) {
+    size_t i = 0, j = 0;
+    uint8x16x4_t lut;
+    lut.val[0] = vld1q_u8((const uint8_t *)encode_table);
+    lut.val[1] = vld1q_u8((const uint8_t *)encode_table + 16);
+    lut.val[2] = vld1q_u8((const uint8_t *)encode_table + 32);
+    lut.val[3] = vld1q_u8((const uint8_t *)encode_table + 48);
+
+    while (i + 48 <= input_len) {
+        const uint8x16x3_t d = vld3q_u8(input + i);
+        uint8x16x4_t e;
+        e.val[0] = vshrq_n_u8(d.val[0], 2);
+        e.val[1] = vorrq_u8(vshlq_n_u8(vandq_u8(d.val[0], vdupq_n_u8(0x03)), 4),
+                            vshrq_n_u8(d.val[1], 4));
+        e.val[2] = vorrq_u8(vshlq_n_u8(vandq_u8(d.val[1], vdupq_n_u8(0x0F)), 2),
+                            vshrq_n_u8(d.val[2], 6));
+        e.val[3] = vandq_u8(d.val[2], vdupq_n_u8(0x3F));
+
+        e.val[0] = vqtbl4q_u8(lut, e.val[0]);
+        e.val[1] = vqtbl4q_u8(lut, e.val[1]);
+        e.val[2] = vqtbl4q_u8(lut, e.val[2]);
+        e.val[3] = vqtbl4q_u8(lut, e.val[3]);
+
+        vst4q_u8((uint8_t *)(output + j), e);
+        i += 48;
+        j += 64;
+    }
+    return i;
+}
+
+/* Map one register of base64 chars to sextets; clears *ok bytes where
+ * a byte is outside the core alphabet ('=' included). */
+static inline uint8x16_t neon_translate(uint8x16_t in, uint8x16_t *ok) {
+    const uint8x16_t m_up = vandq_u8(vcgeq_u8(in, vdupq_n_u8('A')),
+                                     vcleq_u8(in, vdupq_n_u8('Z')));
+    const uint8x16_t m_lo = vandq_u8(vcgeq_u8(in, vdupq_n_u8('a')),
+                                     vcleq_u8(in, vdupq_n_u8('z')));
+    const uint8x16_t m_di = vandq_u8(vcgeq_u8(in, vdupq_n_u8('0')),
+                                     vcleq_u8(in, vdupq_n_u8('9')));
+    const uint8x16_t m_pl = vceqq_u8(in, vdupq_n_u8('+'));
+    const uint8x16_t m_sl = vceqq_u8(in, vdupq_n_u8('/'));
+
+    const uint8x16_t valid = vorrq_u8(
+        vorrq_u8(vorrq_u8(m_up, m_lo), m_di), vorrq_u8(m_pl, m_sl));
+    *ok = vandq_u8(*ok, valid);
+
+    uint8x16_t delta = vandq_u8(m_up, vdupq_n_u8((uint8_t)-65));
+    delta = vorrq_u8(delta, vandq_u8(m_lo, vdupq_n_u8((uint8_t)-71)));
+    delta = vorrq_u8(delta, vandq_u8(m_di, vdupq_n_u8(4)));
+    delta = vorrq_u8(delta, vandq_u8(m_pl, vdupq_n_u8(19)));
+    delta = vorrq_u8(delta, vandq_u8(m_sl, vdupq_n_u8(16)));
+    return vaddq_u8(in, delta);
+}
+
+/* Decode: 64 input chars -> 48 output bytes per step, stopping at the
+ * first chunk containing a non-alphabet byte (scalar code reports it). */
+static size_t decode_bulk_neon(const char *input, size_t input_len,
+                               unsigned char *output) {
+    size_t i = 0, j = 0;
+
+    while (i + 64 <= input_len) {
+        const uint8x16x4_t d = vld4q_u8((const uint8_t *)(input + i));
+        uint8x16_t ok = vdupq_n_u8(0xFF);
+        const uint8x16_t a = neon_translate(d.val[0], &ok);
+        const uint8x16_t b = neon_translate(d.val[1], &ok);
+        const uint8x16_t c = neon_translate(d.val[2], &ok);
+        const uint8x16_t e = neon_translate(d.val[3], &ok);
+        if (vminvq_u8(ok) != 0xFF) break;
+
+        uint8x16x3_t out3;
+        out3.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+        out3.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+        out3.val[2] = vorrq_u8(vshlq_n_u8(c, 6), e);
+        vst3q_u8(output + j, out3);
+        i += 64;
+        j += 48;
+    }
+    return i;
+}
+
+static size_t base64_encode_bulk(const unsigned char *input, size_t input_len,
+                                 char *output) {
+    return encode_bulk_neon(input, input_len, output);
+}
+
+static size_t base64_decode_bulk(const char *input, size_t input_len,
+                                 unsigned char *output) {
+    return decode_bulk_neon(input, input_len, output);
+}
+
+#endif /* BASE64_SIMD_NEON */
+
 /* Validate a character is in the base64 alphabet (including '=' padding) */
 static int is_valid_base64_char(unsigned char c) {
     if (c == '=' || c == '+' || c == '/') return 1;
@@ -121,6 +502,13 @@ int base64_encode(const unsigned char *input, size_t input_len,
 
     size_t i = 0, j = 0;
 
+#if defined(BASE64_SIMD_X86) || defined(BASE64_SIMD_NEON)
+    /* Bulk of the input through the vector kernel; it consumes whole
+     * 3-byte groups, the scalar loop finishes the remainder */
+    i = base64_encode_bulk(input, input_len, output);
+    j = (i / 3) * 4;
+#endif
+
     /* Process 3-byte groups */
     for (; i + 2 < input_len; i += 3) {
         unsigned int triple = ((unsigned int)input[i] << 16) |
@@ -196,7 +584,30 @@ int base64_decode(const char *input, size_t input_len,
         return -1;
     }
 
-    /* Validate all characters and padding position.
+    size_t out_len = (input_len / 4) * 3;
+    if (input[input_len - 1] == '=') out_len--;
+    if (input[input_len - 2] == '=') out_len--;
+
+    if (output_size < out_len) {
+        fprintf(stderr,
+                "base64_decode: output buffer too small: need %zu, got %zu\n",
+                out_len, output_size);
+        return -1;
+    }
+
+    size_t vec_i = 0, j = 0;
+#if defined(BASE64_SIMD_X86) || defined(BASE64_SIMD_NEON)
+    /* Bulk of the input through the vector kernel. Everything it
+     * consumes is validated and decoded; it stops at the first chunk
+     * containing a byte outside the core alphabet, and the final
+     * (possibly padded) block is always left to the scalar code. */
+    if (input_len > 4) {
+        vec_i = base64_decode_bulk(input, input_len - 4, output);
+        j = (vec_i / 4) * 3;
+    }
+#endif
+
+    /* Validate all remaining characters and padding position.
      *
      * Padding rules per 4-byte block:
      *   - '=' may only appear in positions 2 and 3 of the final block.
@@ -205,7 +616,7 @@ int base64_decode(const char *input, size_t input_len,
      *   - Invalid examples: X=XX, X=X=, XX=X, =XXX, ==XX, etc.
      *   - Non-final blocks must not contain '=' at all.
      */
-    for (size_t i = 0; i < input_len; i++) {
+    for (size_t i = vec_i; i < input_len; i++) {
         if (!is_valid_base64_char((unsigned char)input[i])) {
             fprintf(stderr,
                     "base64_decode: invalid character 0x%02x at position %zu; "
@@ -246,19 +657,7 @@ int base64_decode(const char *input, size_t input_len,
         }
     }
 
-    size_t out_len = (input_len / 4) * 3;
-    if (input[input_len - 1] == '=') out_len--;
-    if (input[input_len - 2] == '=') out_len--;
-
-    if (output_size < out_len) {
-        fprintf(stderr,
-                "base64_decode: output buffer too small: need %zu, got %zu\n",
-                out_len, output_size);
-        return -1;
-    }
-
-    size_t j = 0;
-    for (size_t i = 0; i < input_len; i += 4) {
+    for (size_t i = vec_i; i < input_len; i += 4) {
         /* Defence-in-depth: assert decode_table value is not 0xFF (invalid)
          * BEFORE computing sextets. The validation loop above should have
          * caught invalid characters, but this guards against the table
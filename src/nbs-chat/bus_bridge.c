@@ -1,11 +1,18 @@
 /*
  * bus_bridge.c — Chat-to-bus event bridge implementation
  *
- * Publishes bus events via the nbs-bus binary when .nbs/events/ exists.
+ * Publishes bus events when .nbs/events/ exists. Events are published
+ * in-process via libnbs-bus.a (one chat send with three @mentions used
+ * to cost four fork+exec round trips); shelling out to the nbs-bus
+ * binary is kept as a fallback in case the linked library disagrees
+ * with the on-disk bus (e.g. a newer installed nbs-bus understands a
+ * config this library version rejects).
  * All bus failures are non-fatal — chat_send must never fail due to bus issues.
  */
 
 #include "bus_bridge.h"
+#include "prof.h"
+#include "../nbs-bus/bus.h"
 
 #include <ctype.h>
 #include <errno.h>
@@ -65,12 +72,11 @@ int bus_extract_mentions(const char *message,
     int found = 0;
     const char *p = message;
 
-    while (*p != '\0' && found < max_handles) {
-        if (*p != '@') {
-            p++;
-            continue;
-        }
-
+    /* strchr is the platform's vectorised byte scan, so the loop jumps
+     * straight between '@' candidates and pays the boundary checks only
+     * there — cost scales with the number of candidates, not with
+     * message length (pasted logs routinely run to 100 KB+). */
+    while (found < max_handles && (p = strchr(p, '@')) != NULL) {
         /* Found @. Check what precedes it. */
         if (p > message && is_email_prefix_char((unsigned char)*(p - 1))) {
             /* Preceded by email-like character — skip */
@@ -232,17 +238,21 @@ int bus_find_events_dir(const char *chat_path, char *out_buf,
 }
 
 /*
- * bus_publish — Execute nbs-bus publish with the given arguments.
+ * bus_publish_exec — Execute nbs-bus publish as a child process.
+ *
+ * Fallback path only: the normal path is the in-process bridge_publish
+ * below. Kept so an installed nbs-bus binary can still handle an event
+ * this library version cannot.
  *
  * Returns 0 on success, -1 on failure. Failure is non-fatal to the caller.
  */
-static int bus_publish(const char *events_dir, const char *source,
-                       const char *type, const char *priority,
-                       const char *payload) {
-    ASSERT_MSG(events_dir != NULL, "bus_publish: events_dir is NULL");
-    ASSERT_MSG(source != NULL, "bus_publish: source is NULL");
-    ASSERT_MSG(type != NULL, "bus_publish: type is NULL");
-    ASSERT_MSG(priority != NULL, "bus_publish: priority is NULL");
+static int bus_publish_exec(const char *events_dir, const char *source,
+                            const char *type, const char *priority,
+                            const char *payload) {
+    ASSERT_MSG(events_dir != NULL, "bus_publish_exec: events_dir is NULL");
+    ASSERT_MSG(source != NULL, "bus_publish_exec: source is NULL");
+    ASSERT_MSG(type != NULL, "bus_publish_exec: type is NULL");
+    ASSERT_MSG(priority != NULL, "bus_publish_exec: priority is NULL");
 
     /*
      * Build command: nbs-bus publish <dir> <source> <type> <priority> <payload>
@@ -321,6 +331,44 @@ static int bus_publish(const char *events_dir, const char *source,
     return -1;
 }
 
+/*
+ * bridge_publish — Publish one event in-process, shelling out on failure.
+ *
+ * Calls bus_publish() from libnbs-bus.a directly — no fork, no exec, no
+ * PATH search. The library is muted (bus_set_quiet) so event filenames
+ * never leak into chat output. Dedup is intentionally not applied: the
+ * bridge publishes every chat event, matching the old shell-out's
+ * --dedup-window=0.
+ *
+ * If the in-process publish fails, falls back to the nbs-bus binary,
+ * which may be newer than this library and able to handle what we
+ * could not. Returns 0 on success, -1 if both paths failed.
+ */
+static int bridge_publish(const char *events_dir, const char *source,
+                          const char *type, const char *priority,
+                          const char *payload) {
+    ASSERT_MSG(priority != NULL, "bridge_publish: priority is NULL");
+
+    int prio = bus_priority_from_str(priority);
+    ASSERT_MSG(prio >= 0, "bridge_publish: unknown priority '%s'", priority);
+
+    /* Truncate the payload the same way the child process used to */
+    char truncated_payload[MAX_PAYLOAD_LEN];
+    if (payload != NULL) {
+        snprintf(truncated_payload, sizeof(truncated_payload), "%s", payload);
+    } else {
+        truncated_payload[0] = '\0';
+    }
+
+    bus_set_quiet(1);
+    if (bus_publish(events_dir, source, type, prio, truncated_payload) == 0) {
+        return 0;
+    }
+
+    return bus_publish_exec(events_dir, source, type, priority,
+                            truncated_payload);
+}
+
 int bus_bridge_after_send(const char *chat_path, const char *handle,
                           const char *message) {
     ASSERT_MSG(chat_path != NULL,
@@ -330,42 +378,83 @@ int bus_bridge_after_send(const char *chat_path, const char *handle,
     ASSERT_MSG(message != NULL,
                "bus_bridge_after_send: message is NULL");
 
+    prof_t prof;
+    prof_begin(&prof, "bus_bridge_after_send");
+
     /* Find the events directory */
     char events_dir[MAX_PATH_LEN];
     if (bus_find_events_dir(chat_path, events_dir, sizeof(events_dir)) != 0) {
         /* No bus directory — silently return */
         return 0;
     }
-
-    /* Build payload: "handle: message" */
-    char payload[MAX_PAYLOAD_LEN];
-    snprintf(payload, sizeof(payload), "%s: %s", handle, message);
-
-    /* Publish chat-message event */
-    bus_publish(events_dir, "nbs-chat", "chat-message", "normal", payload);
+    prof_phase(&prof, "find_dir");
+
+    /* Every event payload ends with the same "handle: message" tail;
+     * format it once (bounded by MAX_PAYLOAD_LEN, so long messages are
+     * walked a single time) and assemble the per-mention payloads from
+     * it with memcpy instead of re-formatting the message per event. */
+    char payloads[1 + MAX_MENTIONS][MAX_PAYLOAD_LEN];
+    int tail_len = snprintf(payloads[0], MAX_PAYLOAD_LEN, "%s: %s",
+                            handle, message);
+    if (tail_len < 0)
+        tail_len = 0;
+    if (tail_len >= MAX_PAYLOAD_LEN)
+        tail_len = MAX_PAYLOAD_LEN - 1;
 
     /* Check for @mentions */
     char mentions[MAX_MENTIONS][MAX_MENTION_HANDLE_LEN];
     int interrupt_flags[MAX_MENTIONS];
     int mention_count = bus_extract_mentions(message, mentions, MAX_MENTIONS,
                                              interrupt_flags);
+    prof_phase(&prof, "mentions");
+
+    /* Assemble the whole send as one batch: the chat-message event plus
+     * a chat-mention or chat-interrupt event per @handle. One
+     * bus_publish_batch call costs a single directory flush instead of
+     * one per event. */
+    bus_batch_event_t batch[1 + MAX_MENTIONS];
+
+    batch[0].source = "nbs-chat";
+    batch[0].type = "chat-message";
+    batch[0].priority = BUS_PRIORITY_NORMAL;
+    batch[0].payload = payloads[0];
 
-    /* Publish chat-mention or chat-interrupt events for each @handle found */
     for (int i = 0; i < mention_count; i++) {
-        char mention_payload[MAX_PAYLOAD_LEN];
-        snprintf(mention_payload, sizeof(mention_payload),
-                 "@%s from %s: %s", mentions[i], handle, message);
+        char *dst = payloads[1 + i];
+        int n = snprintf(dst, MAX_PAYLOAD_LEN, "@%s from ", mentions[i]);
+        ASSERT_MSG(n > 0 && n < MAX_PAYLOAD_LEN,
+                   "bus_bridge_after_send: mention prefix truncated (%d)", n);
+        int room = MAX_PAYLOAD_LEN - 1 - n;
+        int copy = tail_len < room ? tail_len : room;
+        memcpy(dst + n, payloads[0], (size_t)copy);
+        dst[n + copy] = '\0';
+        batch[1 + i].source = "nbs-chat";
         if (interrupt_flags[i]) {
             /* @handle! — interrupt pattern: critical priority */
-            bus_publish(events_dir, "nbs-chat", "chat-interrupt", "critical",
-                        mention_payload);
+            batch[1 + i].type = "chat-interrupt";
+            batch[1 + i].priority = BUS_PRIORITY_CRITICAL;
         } else {
             /* @handle — normal mention: high priority */
-            bus_publish(events_dir, "nbs-chat", "chat-mention", "high",
-                        mention_payload);
+            batch[1 + i].type = "chat-mention";
+            batch[1 + i].priority = BUS_PRIORITY_HIGH;
         }
+        batch[1 + i].payload = payloads[1 + i];
     }
 
+    bus_set_quiet(1);
+    if (bus_publish_batch(events_dir, batch, 1 + mention_count) != 0) {
+        /* Batch failed — fall back to publishing each event on its own,
+         * which in turn can fall back to the nbs-bus binary. */
+        for (int i = 0; i < 1 + mention_count; i++) {
+            bridge_publish(events_dir, batch[i].source, batch[i].type,
+                           bus_priority_to_str(batch[i].priority),
+                           batch[i].payload);
+        }
+    }
+
+    prof_phase(&prof, "publish");
+    prof_emit(&prof);
+
     /* Postcondition: always returns 0 — bus bridge never fails */
     return 0;
 }
@@ -391,7 +480,8 @@ int bus_bridge_human_input(const char *chat_path, const char *handle,
     snprintf(payload, sizeof(payload), "%s: %s", handle, message);
 
     /* Publish human-input event at high priority */
-    bus_publish(events_dir, "nbs-chat-terminal", "human-input", "high", payload);
+    bridge_publish(events_dir, "nbs-chat-terminal", "human-input", "high",
+                   payload);
 
     /* Postcondition: always returns 0 — bus bridge never fails */
     return 0;
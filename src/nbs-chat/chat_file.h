@@ -13,6 +13,28 @@
  *   ...
  *
  * Each message decodes to: "handle: message text"
+ *
+ * Padded header variant: files written by current versions pad each
+ * header value to a fixed width (spaces) and carry an extra
+ * "message-count:" field. A fixed-width header lets chat_send patch
+ * the header in place with pwrite and append the new message line,
+ * instead of rewriting the whole file. Readers treat padding as
+ * insignificant trailing whitespace, so both layouts parse
+ * identically. Legacy (unpadded) files are migrated to the padded
+ * layout on their next full-rewrite send.
+ *
+ * Version 2 (binary) variant: the first line is "=== nbs-chat v2 ==="
+ * and the header is otherwise the same padded text block, but the body
+ * after "---" holds length-prefixed binary records instead of base64
+ * lines:
+ *
+ *   u32le payload_len | i64le timestamp | u8 handle_len |
+ *   handle bytes | payload bytes | '\n'
+ *
+ * Raw payloads cut storage by a third versus base64 and remove the
+ * decode pass from reads. chat_read and chat_send detect the version
+ * from the first line and support both; chat_migrate (nbs-chat
+ * migrate) converts a v1 file in place. New files default to v1.
  */
 
 #ifndef NBS_CHAT_FILE_H
@@ -54,14 +76,15 @@
  *
  * Invariants:
  *   - handle is always NUL-terminated, length < MAX_HANDLE_LEN
- *   - content is heap-allocated (via strdup) and must be freed by caller
+ *   - content points into the owning chat_state_t's arena; it is
+ *     released by chat_state_free() and must never be freed individually
  *   - content_len == strlen(content) when content is valid text
  *   - timestamp is 0 for legacy messages without embedded timestamps,
  *     or a positive epoch-seconds value for timestamped messages
  */
 typedef struct {
     char handle[MAX_HANDLE_LEN];
-    char *content;     /* Dynamically allocated */
+    char *content;     /* Carved from the state's arena */
     size_t content_len;
     time_t timestamp;  /* Epoch seconds, 0 = no timestamp (legacy message) */
 } chat_message_t;
@@ -83,9 +106,13 @@ typedef struct {
  *   - message_count >= 0 && message_count <= MAX_MESSAGES
  *   - participant_count >= 0 && participant_count <= MAX_PARTICIPANTS
  *   - messages != NULL when message_count > 0
- *   - messages is heap-allocated and must be freed via chat_state_free()
+ *   - messages and arena are owned by the state and released together
+ *     by chat_state_free(); message content is bump-allocated from the
+ *     arena (a few large blocks instead of one malloc per message)
  *   - file_length >= 0 when read from a valid chat file
  */
+struct chat_arena_block;
+
 typedef struct {
     char last_writer[MAX_HANDLE_LEN];
     char last_write[64];  /* ISO 8601 timestamp */
@@ -95,6 +122,11 @@ typedef struct {
     chat_message_t *messages;
     int message_count;
     int skipped_count;  /* Messages skipped due to decode/alloc failure */
+    int64_t end_offset; /* Byte offset just past the last parsed line
+                           (file size at read time), or -1 if unknown.
+                           Feed back into chat_read_from to resume. */
+    int format_version; /* 1 = base64 lines, 2 = binary records */
+    struct chat_arena_block *arena; /* Message content storage */
 } chat_state_t;
 
 /*
@@ -131,6 +163,91 @@ int chat_create(const char *path);
  */
 int chat_read(const char *path, chat_state_t *state);
 
+/*
+ * chat_read_from — Incremental tail read: decode only messages at or
+ * past a known byte offset.
+ *
+ * Preconditions:
+ *   - path != NULL
+ *   - byte_offset >= 0, pointing at the start of a message line
+ *     (typically a previous state's end_offset, or a cursor offset)
+ *   - state != NULL
+ *
+ * Postconditions:
+ *   - On success (returns 0): header fields are populated as in
+ *     chat_read(); state->messages holds only the messages from
+ *     byte_offset to EOF, so decoding cost is O(new messages), not
+ *     O(history). Message indices in state are relative to the tail.
+ *   - Returns 1: byte_offset is unusable (past EOF, inside the header,
+ *     or not on a line boundary — e.g. the file was rewritten). The
+ *     caller should fall back to chat_read().
+ *   - Returns -1: error; state contents are undefined
+ *
+ * Caller must call chat_state_free() on the result after successful return.
+ * Returns 0 on success, 1 if the offset is stale, -1 on error.
+ */
+int chat_read_from(const char *path, int64_t byte_offset, chat_state_t *state);
+
+/*
+ * chat_segment_count — Number of sealed segments behind a chat file.
+ *
+ * Sealed segments live at <path>.seg.NNNN, numbered contiguously from
+ * 0001; the count is found by probing for the first gap.
+ *
+ * Preconditions: path non-NULL (asserted).
+ * Returns the number of sealed segments (0 for an unrotated chat).
+ */
+int chat_segment_count(const char *path);
+
+/*
+ * chat_read_segments — Read a chat plus as much sealed history as the
+ * caller needs.
+ *
+ * Reads the active file, then lazily pulls sealed segments in (newest
+ * first) until state holds at least want_last messages, or all of them
+ * when want_last < 0. Messages are ordered oldest first across the
+ * whole result; message_count may exceed MAX_MESSAGES, which is a
+ * per-segment parser limit. A segment that cannot be read is reported
+ * as a warning and the segments before it are skipped — partial
+ * history beats failing the read.
+ *
+ * Caller must call chat_state_free() on the result after successful
+ * return. Returns 0 on success, -1 when the active file cannot be read.
+ */
+int chat_read_segments(const char *path, int want_last, chat_state_t *state);
+
+/*
+ * Streaming reads — decode one message at a time.
+ *
+ * chat_read materialises the whole history (up to MAX_MESSAGES x
+ * MAX_MESSAGE_LEN); a stream keeps one message resident at a time, so
+ * scans of many large chats stay at O(largest message) heap and can
+ * start printing before the file is fully parsed.
+ *
+ *   chat_stream_t *st = chat_open_stream(path);
+ *   chat_message_t msg;
+ *   while (st && chat_next_message(st, &msg) == 0) ...use msg...
+ *   chat_close_stream(st);
+ *
+ * msg.content points into the stream's reusable decode buffer: it is
+ * valid only until the next chat_next_message or chat_close_stream
+ * call and must never be freed. The stream holds the shared read lock
+ * (none in snapshot mode) from open to close, so keep streams
+ * short-lived. Streams have no MAX_MESSAGES cap — that limit bounds
+ * chat_read's materialised array, which a stream does not build.
+ *
+ * chat_open_stream returns NULL on error (errno set by open/fstat).
+ * chat_next_message returns 0 when msg holds the next message, 1 at
+ * end of stream. Undecodable messages are passed over and tallied;
+ * chat_stream_skipped returns the count so far.
+ */
+typedef struct chat_stream chat_stream_t;
+
+chat_stream_t *chat_open_stream(const char *path);
+int chat_next_message(chat_stream_t *st, chat_message_t *msg);
+int chat_stream_skipped(const chat_stream_t *st);
+void chat_close_stream(chat_stream_t *st);
+
 /*
  * chat_send — Append a message to a chat file.
  *
@@ -144,11 +261,67 @@ int chat_read(const char *path, chat_state_t *state);
  *     file-length header matches actual file size
  *   - On error (returns -1 or -2): file may or may not have been modified
  *
- * Acquires lock, reads file, appends message, updates headers, writes back.
+ * Acquires lock, then takes one of two paths:
+ *   - Fast path (padded header): appends the encoded line and patches
+ *     the fixed-width header in place — O(message size).
+ *   - Full rewrite (legacy header, or participants line outgrew its
+ *     padding): reads the file, rewrites it with updated headers, and
+ *     migrates the header to the padded layout when it fits.
+ *
+ * When NBS_CHAT_SEGMENT_MSGS is set to N > 0 and the active file holds
+ * at least N messages, the send first seals it into <path>.seg.NNNN
+ * and starts a fresh active file (segment rotation); see
+ * chat_read_segments for reading the sealed history back.
  * Returns 0 on success, -1 on error, -2 on I/O flush error.
  */
 int chat_send(const char *path, const char *handle, const char *message);
 
+/*
+ * chat_send_batch — Append several messages as one group commit.
+ *
+ * Preconditions:
+ *   - path != NULL
+ *   - handle != NULL
+ *   - messages != NULL (or count == 0)
+ *   - count >= 0
+ *
+ * Postconditions:
+ *   - On success (returns 0): all count messages are appended in order,
+ *     sharing one timestamp, and the header is patched once
+ *   - On error (returns -1): a prefix of the batch may have been sent
+ *
+ * The whole burst costs one lock acquisition, one header pwrite and one
+ * data pwrite instead of one of each per message. Files the fast path
+ * cannot handle (legacy header, snapshot mode) fall back to per-message
+ * chat_send, which repairs or migrates the file as usual.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int chat_send_batch(const char *path, const char *handle,
+                    const char *const *messages, int count);
+
+/*
+ * chat_migrate — Convert a v1 (base64) chat file to the v2 binary format.
+ *
+ * Preconditions:
+ *   - path != NULL (must refer to an existing chat file)
+ *
+ * Postconditions:
+ *   - On success (returns 0): file is in v2 format with all messages,
+ *     participants and header fields preserved; the index sidecar is
+ *     rebuilt to the new byte offsets
+ *   - Returns 1: file is already v2 — nothing to do
+ *   - Returns -1: error; the original file is untouched (the conversion
+ *     is written to a temp file and renamed into place)
+ *
+ * Holds the exclusive chat lock for the duration. Read cursors' byte
+ * offsets become stale after migration, which readers detect and
+ * recover from with a full scan.
+ *
+ * Returns 0 on success, 1 if already v2, -1 on error.
+ */
+int chat_migrate(const char *path);
+
 /*
  * chat_poll — Wait for a new message not from the given handle.
  *
@@ -162,6 +335,12 @@ int chat_send(const char *path, const char *handle, const char *message);
  *   - Returns 3: timeout_secs elapsed with no new messages from others
  *   - Returns -1: error reading the chat file
  *
+ * On Linux this blocks in the kernel on an inotify watch of the chat
+ * file's directory and re-parses only when the file actually changes,
+ * waking within milliseconds of a write. If inotify is unavailable
+ * (other platforms, or the watch limit is hit) it falls back to
+ * re-reading the file once per second.
+ *
  * Returns 0 if a new message arrived, 3 on timeout, -1 on error.
  */
 int chat_poll(const char *path, const char *handle, int timeout_secs);
@@ -178,6 +357,90 @@ int chat_poll(const char *path, const char *handle, int timeout_secs);
  */
 void chat_state_free(chat_state_t *state);
 
+/*
+ * chat_state_cache_enable — Cache parsed states for repeated reads.
+ *
+ * Opt-in for long-lived processes (nbs-chat serve): once enabled,
+ * chat_read serves a full-file read from a small in-memory cache when
+ * a single stat shows the file unchanged (same size and mtime) — a
+ * deep copy instead of a reparse. One-shot CLI invocations never
+ * enable this and are unaffected. There is no way to disable it again;
+ * writers need no invalidation hook because any append or rewrite
+ * changes the size or mtime and the next stat simply misses.
+ */
+void chat_state_cache_enable(void);
+
+/*
+ * chat_snapshot_enable — Switch a chat file to snapshot mode.
+ *
+ * Creates the `<path>.snapshot` marker sidecar. From the next send on,
+ * writers publish each new version of the file via write-to-temp +
+ * rename(2), and readers open and parse it with no lock at all — a
+ * wedged writer holding the .lock file can no longer block reads.
+ * Writers still serialise among themselves through the exclusive lock.
+ *
+ * The trade: the in-place append fast path is disabled for the file,
+ * so every send costs O(file size). Opt in per file, for chats read
+ * far more often than written. Binaries without snapshot support
+ * ignore the marker and keep the locked behaviour.
+ *
+ * Preconditions: path non-NULL (asserted).
+ * Returns 0 on success (idempotent), -1 if the marker cannot be
+ * created.
+ */
+int chat_snapshot_enable(const char *path);
+
+/* One entry of the <chat_path>.idx sidecar: where a message's encoded
+ * line lives in the chat file, who sent it, and when.
+ *
+ * Invariants:
+ *   - offset >= 0, length > 0 (length includes the trailing newline)
+ *   - handle is NUL-terminated, length < MAX_HANDLE_LEN
+ *   - timestamp is epoch seconds, 0 for legacy messages
+ */
+typedef struct {
+    int64_t offset;
+    int32_t length;
+    char handle[MAX_HANDLE_LEN];
+    int64_t timestamp;
+} chat_idx_record_t;
+
+/*
+ * chat_idx_count — Number of records in a chat's index sidecar.
+ *
+ * Preconditions:
+ *   - chat_path != NULL
+ *
+ * Postconditions:
+ *   - Returns >= 0: the index exists and is fresh (its recorded chat
+ *     file length matches the chat file's actual size); the return
+ *     value is the message count
+ *   - Returns -1: index absent, stale, or malformed — callers fall
+ *     back to a full scan
+ *
+ * The index is advisory: it is maintained by chat_send under the chat
+ * lock and rebuilt or dropped whenever it cannot be kept consistent.
+ */
+int chat_idx_count(const char *chat_path);
+
+/*
+ * chat_idx_get — Fetch one index record by message index.
+ *
+ * Preconditions:
+ *   - chat_path != NULL
+ *   - index >= 0
+ *   - rec != NULL
+ *
+ * Postconditions:
+ *   - Returns 0: *rec is populated; rec->offset is suitable for
+ *     chat_read_from()
+ *   - Returns -1: index absent, out of range, or malformed
+ *
+ * Callers should treat any -1 as "use the full scan"; freshness is
+ * checked by chat_idx_count() first.
+ */
+int chat_idx_get(const char *chat_path, int index, chat_idx_record_t *rec);
+
 /*
  * chat_cursor_read — Get the read cursor for a handle.
  *
@@ -197,6 +460,25 @@ void chat_state_free(chat_state_t *state);
  */
 int chat_cursor_read(const char *chat_path, const char *handle);
 
+/*
+ * chat_cursor_read_pos — Get the read cursor and byte offset for a handle.
+ *
+ * Preconditions:
+ *   - chat_path != NULL
+ *   - handle != NULL
+ *   - index != NULL, offset != NULL
+ *
+ * Postconditions:
+ *   - Returns 0: *index is the last-read message index; *offset is the
+ *     byte offset just past that message (for chat_read_from), or -1
+ *     if the cursor predates offset tracking
+ *   - Returns -1: no cursor for this handle; *index and *offset are -1
+ *
+ * Returns 0 if a cursor was found, -1 otherwise.
+ */
+int chat_cursor_read_pos(const char *chat_path, const char *handle,
+                         int *index, int64_t *offset);
+
 /*
  * chat_cursor_write — Set the read cursor for a handle.
  *
@@ -216,4 +498,15 @@ int chat_cursor_read(const char *chat_path, const char *handle);
  */
 int chat_cursor_write(const char *chat_path, const char *handle, int index);
 
+/*
+ * chat_cursor_write_pos — Set the read cursor and byte offset for a handle.
+ *
+ * Same contract as chat_cursor_write(), additionally recording the byte
+ * offset just past the last-read message (a state's end_offset) so the
+ * next read can seek there with chat_read_from(). Pass offset -1 when
+ * the offset is unknown; readers then fall back to a full scan.
+ */
+int chat_cursor_write_pos(const char *chat_path, const char *handle,
+                          int index, int64_t offset);
+
 #endif /* NBS_CHAT_FILE_H */
@@ -4,6 +4,7 @@
 
 #include "lock.h"
 #include "chat_file.h"
+#include "prof.h"
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -11,25 +12,34 @@
 #include <string.h>
 #include <unistd.h>
 
-int chat_lock_acquire(const char *chat_path) {
-    ASSERT_MSG(chat_path != NULL, "chat_lock_acquire: path is NULL");
+/*
+ * lock_acquire_type — Shared implementation for both lock flavours.
+ *
+ * lock_type is F_WRLCK (exclusive) or F_RDLCK (shared). caller names
+ * the public entry point for warning messages.
+ */
+static int lock_acquire_type(const char *chat_path, short lock_type,
+                             const char *caller) {
+    ASSERT_MSG(chat_path != NULL, "%s: path is NULL", caller);
+    ASSERT_MSG(lock_type == F_WRLCK || lock_type == F_RDLCK,
+               "%s: invalid lock type %d", caller, lock_type);
 
     /* Build lock file path: chat_path + ".lock" */
     size_t path_len = strlen(chat_path);
     ASSERT_MSG(path_len + 6 <= MAX_PATH_LEN,
-               "chat_lock_acquire: path too long: %zu + 6 > %d", path_len, MAX_PATH_LEN);
+               "%s: path too long: %zu + 6 > %d", caller, path_len, MAX_PATH_LEN);
     char lock_path[MAX_PATH_LEN];
     snprintf(lock_path, sizeof(lock_path), "%s.lock", chat_path);
 
     int fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
     if (fd < 0) {
-        fprintf(stderr, "warning: chat_lock_acquire: open failed for %s: %s\n",
-                lock_path, strerror(errno));
+        fprintf(stderr, "warning: %s: open failed for %s: %s\n",
+                caller, lock_path, strerror(errno));
         return -1;
     }
 
     struct flock fl = {
-        .l_type = F_WRLCK,
+        .l_type = lock_type,
         .l_whence = SEEK_SET,
         .l_start = 0,
         .l_len = 0, /* Lock entire file */
@@ -41,16 +51,28 @@ int chat_lock_acquire(const char *chat_path) {
      * A timeout is not used because POSIX fcntl does not support one, and
      * alarm-based interruption would complicate error handling for minimal
      * benefit given the expected short hold times. */
+    prof_t prof;
+    prof_begin(&prof, caller);
     if (fcntl(fd, F_SETLKW, &fl) < 0) {
-        fprintf(stderr, "warning: chat_lock_acquire: fcntl lock failed for %s: %s\n",
-                lock_path, strerror(errno));
+        fprintf(stderr, "warning: %s: fcntl lock failed for %s: %s\n",
+                caller, lock_path, strerror(errno));
         close(fd);
         return -1;
     }
+    prof_phase(&prof, "wait");
+    prof_emit(&prof);
 
     return fd;
 }
 
+int chat_lock_acquire(const char *chat_path) {
+    return lock_acquire_type(chat_path, F_WRLCK, "chat_lock_acquire");
+}
+
+int chat_lock_acquire_shared(const char *chat_path) {
+    return lock_acquire_type(chat_path, F_RDLCK, "chat_lock_acquire_shared");
+}
+
 void chat_lock_release(int lock_fd) {
     ASSERT_MSG(lock_fd >= 0, "chat_lock_release: invalid fd %d", lock_fd);
 
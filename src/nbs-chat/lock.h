@@ -29,6 +29,25 @@
  */
 int chat_lock_acquire(const char *chat_path);
 
+/*
+ * chat_lock_acquire_shared — Acquire shared (read) advisory lock.
+ *
+ * Same contract as chat_lock_acquire but takes F_RDLCK, so any number
+ * of readers hold the lock concurrently while writers (F_WRLCK via
+ * chat_lock_acquire) still get exclusivity. Used by read-only paths:
+ * under a read-heavy workload readers no longer serialise behind each
+ * other, only behind an in-progress write.
+ *
+ * CAUTION: fcntl locks do not nest within a process — acquiring a
+ * shared lock on a file while this process already holds the exclusive
+ * lock would silently downgrade it. Never call this with the exclusive
+ * lock held (chat_send reads via the internal unlocked parser for this
+ * reason).
+ *
+ * Returns fd >= 0 on success (lock held), -1 on error.
+ */
+int chat_lock_acquire_shared(const char *chat_path);
+
 /*
  * chat_lock_release — Release exclusive advisory lock.
  *
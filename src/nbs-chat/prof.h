@@ -0,0 +1,101 @@
+/*
+ * prof.h — Opt-in hot-path phase timing (NBS_PROF=1).
+ *
+ * When a send or read is slow in production, the question is always
+ * "where did the time go": lock wait, parse, encode, the rewrite, or
+ * the bus bridge. With NBS_PROF=1 in the environment, each
+ * instrumented operation emits one machine-parsable stderr line:
+ *
+ *   PROF: op=chat_send lock=12 encode=1 append=9 cursor=4 total=26
+ *
+ * (values are microseconds). With NBS_PROF unset the cost is one
+ * getenv on first use, cached, then a single predictable branch per
+ * phase — nothing is formatted, nothing is timed.
+ *
+ * Usage:
+ *   prof_t p;
+ *   prof_begin(&p, "chat_send");
+ *   ... do the lock ...
+ *   prof_phase(&p, "lock");
+ *   ... do the append ...
+ *   prof_phase(&p, "append");
+ *   prof_emit(&p);
+ *
+ * Header-only by design: lock.c, chat_file.c and bus_bridge.c all
+ * instrument without adding a translation unit to every link line.
+ */
+
+#ifndef NBS_CHAT_PROF_H
+#define NBS_CHAT_PROF_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROF_MAX_PHASES 8
+
+typedef struct {
+    const char *op;
+    int n;
+    const char *names[PROF_MAX_PHASES];
+    long long us[PROF_MAX_PHASES];
+    long long t_phase; /* start of the phase currently running */
+} prof_t;
+
+/* Cached NBS_PROF=1 check — getenv runs once per translation unit */
+static inline int prof_enabled(void)
+{
+    static int cached = -1;
+    if (cached < 0) {
+        const char *v = getenv("NBS_PROF");
+        cached = (v != NULL && strcmp(v, "1") == 0) ? 1 : 0;
+    }
+    return cached;
+}
+
+static inline long long prof_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static inline void prof_begin(prof_t *p, const char *op)
+{
+    p->op = op;
+    p->n = 0;
+    p->t_phase = 0;
+    if (!prof_enabled())
+        return;
+    p->t_phase = prof_now_us();
+}
+
+/* Close the running phase under `name` and start the next one */
+static inline void prof_phase(prof_t *p, const char *name)
+{
+    if (!prof_enabled())
+        return;
+    long long now = prof_now_us();
+    if (p->n < PROF_MAX_PHASES) {
+        p->names[p->n] = name;
+        p->us[p->n] = now - p->t_phase;
+        p->n++;
+    }
+    p->t_phase = now;
+}
+
+static inline void prof_emit(const prof_t *p)
+{
+    if (!prof_enabled() || p->n == 0)
+        return;
+    fprintf(stderr, "PROF: op=%s", p->op);
+    long long total = 0;
+    for (int i = 0; i < p->n; i++) {
+        fprintf(stderr, " %s=%lld", p->names[i], p->us[i]);
+        total += p->us[i];
+    }
+    fprintf(stderr, " total=%lld\n", total);
+}
+
+#endif /* NBS_CHAT_PROF_H */
@@ -10,6 +10,22 @@
  *   NBS_CHAT_KEY   (optional) — path to SSH identity file
  *   NBS_CHAT_BIN   (optional) — remote nbs-chat path, default "nbs-chat"
  *   NBS_CHAT_OPTS  (optional) — comma-separated SSH -o options
+ *   NBS_CHAT_MUX   (optional) — connection reuse: seconds to keep the
+ *                  multiplexed master alive (default 60; 0/off disables)
+ *
+ * Connection reuse drives OpenSSH ControlMaster: the first command pays
+ * the full handshake and leaves a master behind (ControlPersist); every
+ * later command rides the existing connection, so a remote poll loop
+ * costs roughly RTT + remote command time instead of 300-800 ms of
+ * setup per iteration. If the control directory cannot be prepared the
+ * proxy warns and falls back to plain per-command connections.
+ *
+ * Batch mode ("nbs-chat-remote batch") reads one nbs-chat command per
+ * stdin line and ships them all in a single SSH invocation — the common
+ * read/send/poll supervisor sequence costs one WAN round trip instead
+ * of three. Each command's output is followed by a delimiter line
+ * "--- batch:<n> exit:<code> ---"; the batch exits with the first
+ * non-zero command exit code.
  *
  * Exit codes mirror nbs-chat exactly (0-4), with SSH failures mapped to 1.
  */
@@ -20,6 +36,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -43,8 +60,74 @@ typedef struct {
     const char *key_path;    /* NBS_CHAT_KEY (optional) */
     const char *remote_bin;  /* NBS_CHAT_BIN (default "nbs-chat") */
     const char *ssh_opts;    /* NBS_CHAT_OPTS (optional) — comma-separated -o options */
+    int mux_persist_s;       /* NBS_CHAT_MUX (default 60; 0 = no multiplexing) */
+    char mux_path_opt[256];  /* "ControlPath=<dir>/%C" (empty = multiplexing off) */
+    char mux_persist_opt[32];/* "ControlPersist=<n>s" */
 } remote_config_t;
 
+/*
+ * mux_setup — Prepare the ControlMaster socket directory and options.
+ *
+ * Picks a per-user directory ($XDG_RUNTIME_DIR, $TMPDIR or /tmp, plus a
+ * uid-suffixed subdirectory created mode 0700) and fills the ControlPath
+ * and ControlPersist option strings. The path uses ssh's %C token — a
+ * hash of local host, remote host, port and user — so distinct targets
+ * never share a socket and the path stays short enough for a unix
+ * socket.
+ *
+ * SECURITY: refuses a directory that is not owned by us or is group/
+ * other accessible; a hijacked control socket is remote code execution.
+ *
+ * Preconditions:  cfg != NULL, cfg->mux_persist_s set
+ * Postconditions: cfg->mux_path_opt is filled in, or empty with a
+ *                 warning printed (multiplexing disabled, never fatal).
+ */
+static void mux_setup(remote_config_t *cfg)
+{
+    ASSERT_MSG(cfg != NULL, "mux_setup: cfg is NULL");
+
+    cfg->mux_path_opt[0] = '\0';
+    cfg->mux_persist_opt[0] = '\0';
+    if (cfg->mux_persist_s <= 0)
+        return;
+
+    const char *base = getenv("XDG_RUNTIME_DIR");
+    if (!base || base[0] == '\0')
+        base = getenv("TMPDIR");
+    if (!base || base[0] == '\0')
+        base = "/tmp";
+
+    char dir[192];
+    int dlen = snprintf(dir, sizeof(dir), "%s/nbs-chat-mux-%ld",
+                        base, (long)getuid());
+    /* %C expands to a 40-char hash; the whole socket path must stay
+     * under the ~104-byte unix socket limit */
+    if (dlen < 0 || (size_t)dlen >= sizeof(dir) || dlen + 48 > 100) {
+        fprintf(stderr, "Warning: control socket path too long, "
+                "multiplexing disabled\n");
+        return;
+    }
+
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Warning: cannot create %s: %s — "
+                "multiplexing disabled\n", dir, strerror(errno));
+        return;
+    }
+
+    struct stat st;
+    if (lstat(dir, &st) != 0 || !S_ISDIR(st.st_mode) ||
+        st.st_uid != getuid() || (st.st_mode & 077) != 0) {
+        fprintf(stderr, "Warning: %s is not a private directory owned "
+                "by us — multiplexing disabled\n", dir);
+        return;
+    }
+
+    snprintf(cfg->mux_path_opt, sizeof(cfg->mux_path_opt),
+             "ControlPath=%s/%%C", dir);
+    snprintf(cfg->mux_persist_opt, sizeof(cfg->mux_persist_opt),
+             "ControlPersist=%ds", cfg->mux_persist_s);
+}
+
 /*
  * load_config — Load SSH configuration from environment variables.
  *
@@ -88,6 +171,25 @@ static int load_config(remote_config_t *cfg)
     if (cfg->ssh_opts && cfg->ssh_opts[0] == '\0')
         cfg->ssh_opts = NULL;
 
+    cfg->mux_persist_s = 60;
+    const char *mux_str = getenv("NBS_CHAT_MUX");
+    if (mux_str && mux_str[0] != '\0') {
+        if (strcmp(mux_str, "off") == 0 || strcmp(mux_str, "no") == 0) {
+            cfg->mux_persist_s = 0;
+        } else {
+            char *endptr;
+            errno = 0;
+            long val = strtol(mux_str, &endptr, 10);
+            if (errno != 0 || *endptr != '\0' || val < 0 || val > 86400) {
+                fprintf(stderr, "Error: Invalid NBS_CHAT_MUX: %s "
+                        "(seconds 0-86400, or off)\n", mux_str);
+                return 4;
+            }
+            cfg->mux_persist_s = (int)val;
+        }
+    }
+    mux_setup(cfg);
+
     /* Postcondition: on success, host is non-NULL and non-empty */
     ASSERT_MSG(cfg->host != NULL && cfg->host[0] != '\0',
                "load_config postcondition: host is NULL or empty after successful load");
@@ -177,6 +279,9 @@ static int contains_shell_metachar(const char *s)
     return 0;
 }
 
+static char **assemble_ssh_argv(const remote_config_t *cfg, char *remote_cmd,
+                                char **opts_out, char **port_str_out);
+
 /*
  * build_ssh_argv — Construct the ssh command argument vector.
  *
@@ -287,14 +392,41 @@ static char **build_ssh_argv(const remote_config_t *cfg,
 
     free(esc_buf);
 
+    char **argv = assemble_ssh_argv(cfg, remote_cmd, opts_out, port_str_out);
+    if (!argv) free(remote_cmd);
+    return argv;
+}
+
+/*
+ * assemble_ssh_argv — Wrap a prepared remote command in the ssh argv.
+ *
+ * Shared by the single-command path (build_ssh_argv) and batch mode,
+ * which assemble remote_cmd differently but run it identically.
+ * Ownership of remote_cmd stays with the caller; on success it becomes
+ * the last non-NULL argv element (the caller's existing cleanup walk).
+ *
+ * Preconditions:  cfg != NULL, remote_cmd != NULL
+ * Postconditions: Same as build_ssh_argv.
+ */
+static char **assemble_ssh_argv(const remote_config_t *cfg, char *remote_cmd,
+                                char **opts_out, char **port_str_out)
+{
+    ASSERT_MSG(cfg != NULL, "assemble_ssh_argv: cfg is NULL");
+    ASSERT_MSG(remote_cmd != NULL, "assemble_ssh_argv: remote_cmd is NULL");
+
+    *opts_out = NULL;
+    *port_str_out = NULL;
+
     /*
      * Build SSH argv.
-     * Maximum elements: ssh -p PORT -i KEY -o OPT1 -o OPT2 -o OPT3 -o OPT4 host REMOTE_CMD NULL
-     *                    1    2       2      2       2       2       2       1     1          1 = 16
+     * Maximum elements: ssh -p PORT -i KEY -o OPT1..OPT4 (x2 each)
+     *                   -o ControlMaster -o ControlPath -o ControlPersist
+     *                   host REMOTE_CMD NULL
+     *                   1 + 2 + 2 + 8 + 6 + 1 + 1 + 1 = 22
      */
-    const int max_args = 16;
+    const int max_args = 22;
     char **argv = calloc((size_t)max_args, sizeof(char *));
-    if (!argv) { free(remote_cmd); return NULL; }
+    if (!argv) return NULL;
 
     int ai = 0;
     /* ai < max_args checked before every write */
@@ -306,7 +438,7 @@ static char **build_ssh_argv(const remote_config_t *cfg,
         char port_buf[8];
         snprintf(port_buf, sizeof(port_buf), "%d", cfg->port);
         char *port_heap = strdup(port_buf);
-        if (!port_heap) { free(remote_cmd); free(argv); return NULL; }
+        if (!port_heap) { free(argv); return NULL; }
         *port_str_out = port_heap;
 
         ASSERT_MSG(ai + 1 < max_args,
@@ -334,7 +466,6 @@ static char **build_ssh_argv(const remote_config_t *cfg,
         if (contains_shell_metachar(cfg->ssh_opts)) {
             fprintf(stderr, "Error: NBS_CHAT_OPTS contains dangerous characters "
                     "(;`$()| etc.) — refusing to proceed\n");
-            free(remote_cmd);
             free(*port_str_out);
             *port_str_out = NULL;
             free(argv);
@@ -363,6 +494,19 @@ static char **build_ssh_argv(const remote_config_t *cfg,
         }
     }
 
+    /* Connection multiplexing: reuse one master connection across
+     * commands instead of a fresh handshake per invocation */
+    if (cfg->mux_path_opt[0] != '\0') {
+        ASSERT_MSG(ai + 5 < max_args,
+                   "build_ssh_argv: argv overflow before mux options, ai=%d", ai);
+        argv[ai++] = (char *)"-o";
+        argv[ai++] = (char *)"ControlMaster=auto";
+        argv[ai++] = (char *)"-o";
+        argv[ai++] = (char *)cfg->mux_path_opt;
+        argv[ai++] = (char *)"-o";
+        argv[ai++] = (char *)cfg->mux_persist_opt;
+    }
+
     /* Host */
     ASSERT_MSG(ai < max_args,
                "build_ssh_argv: argv overflow before host, ai=%d", ai);
@@ -380,6 +524,191 @@ static char **build_ssh_argv(const remote_config_t *cfg,
     return argv;
 }
 
+/* ── Batch mode ──────────────────────────────────────────────────── */
+
+/*
+ * tokenize_line — Split a batch line into words, honouring quotes.
+ *
+ * Splits on unquoted whitespace. Single quotes protect everything up to
+ * the closing quote; double quotes likewise but allow backslash escapes;
+ * an unquoted backslash escapes the next character. Words are compacted
+ * in place (line is modified) and words[] points into it.
+ *
+ * Preconditions:  line != NULL, words != NULL, max_words > 0
+ * Postconditions: Returns word count (>= 0), words[0..n-1] NUL-terminated.
+ *                 Returns -1 on unterminated quote or too many words.
+ */
+static int tokenize_line(char *line, char **words, int max_words)
+{
+    ASSERT_MSG(line != NULL, "tokenize_line: line is NULL");
+    ASSERT_MSG(words != NULL, "tokenize_line: words is NULL");
+    ASSERT_MSG(max_words > 0, "tokenize_line: max_words is %d", max_words);
+
+    int count = 0;
+    char *src = line;
+    char *dst = line;
+
+    for (;;) {
+        while (*src == ' ' || *src == '\t' || *src == '\n')
+            src++;
+        if (*src == '\0')
+            break;
+        if (count >= max_words)
+            return -1;
+
+        words[count] = dst;
+        while (*src != '\0' && *src != ' ' && *src != '\t' && *src != '\n') {
+            if (*src == '\'') {
+                src++;
+                while (*src != '\'' && *src != '\0')
+                    *dst++ = *src++;
+                if (*src == '\0')
+                    return -1; /* unterminated quote */
+                src++;
+            } else if (*src == '"') {
+                src++;
+                while (*src != '"' && *src != '\0') {
+                    if (*src == '\\' && src[1] != '\0')
+                        src++;
+                    *dst++ = *src++;
+                }
+                if (*src == '\0')
+                    return -1; /* unterminated quote */
+                src++;
+            } else if (*src == '\\' && src[1] != '\0') {
+                src++;
+                *dst++ = *src++;
+            } else {
+                *dst++ = *src++;
+            }
+        }
+        if (*src != '\0')
+            src++;
+        *dst++ = '\0';
+        count++;
+    }
+
+    return count;
+}
+
+/* Growable string buffer for assembling the batch remote command */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} strbuf_t;
+
+static int strbuf_append(strbuf_t *sb, const char *str)
+{
+    size_t slen = strlen(str);
+    if (sb->len + slen + 1 > sb->cap) {
+        size_t new_cap = sb->cap ? sb->cap * 2 : 1024;
+        while (new_cap < sb->len + slen + 1)
+            new_cap *= 2;
+        char *grown = realloc(sb->data, new_cap);
+        if (!grown) return -1;
+        sb->data = grown;
+        sb->cap = new_cap;
+    }
+    memcpy(sb->data + sb->len, str, slen + 1);
+    sb->len += slen;
+    return 0;
+}
+
+/*
+ * build_batch_remote_cmd — Assemble one remote command from batch lines.
+ *
+ * Reads one nbs-chat command per line from `in` (subcommand + args, no
+ * leading binary name), shell-escapes every word, and joins the commands
+ * into a single POSIX sh program:
+ *
+ *   rc=0; <cmd1>; s=$?; [ "$rc" -eq 0 ] || true; ...; exit "$rc"
+ *
+ * After each command a delimiter "--- batch:<n> exit:<code> ---" is
+ * printed so the caller can split the streamed output, and rc keeps the
+ * first non-zero exit code. Every user-supplied word passes through
+ * shell_escape; all control text is generated here.
+ *
+ * Preconditions:  cfg != NULL, in != NULL
+ * Postconditions: Returns a heap-allocated command string (caller
+ *                 frees), or NULL with an error printed.
+ */
+static char *build_batch_remote_cmd(const remote_config_t *cfg, FILE *in)
+{
+    ASSERT_MSG(cfg != NULL, "build_batch_remote_cmd: cfg is NULL");
+    ASSERT_MSG(in != NULL, "build_batch_remote_cmd: in is NULL");
+
+    strbuf_t sb = { NULL, 0, 0 };
+    if (strbuf_append(&sb, "rc=0") != 0) goto oom;
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t line_len;
+    int cmd_no = 0;
+    char esc_buf[4096 * 4 + 8];
+
+    while ((line_len = getline(&line, &line_cap, in)) != -1) {
+        char *words[64];
+        int nwords = tokenize_line(line, words, 64);
+        if (nwords < 0) {
+            fprintf(stderr, "Error: batch line %d: unterminated quote "
+                    "or too many words\n", cmd_no + 1);
+            free(line);
+            free(sb.data);
+            return NULL;
+        }
+        if (nwords == 0)
+            continue; /* blank line */
+
+        cmd_no++;
+
+        /* '; ' then the escaped command */
+        if (strbuf_append(&sb, "; ") != 0) goto oom_line;
+        if (shell_escape(cfg->remote_bin, esc_buf, sizeof(esc_buf)) < 0 ||
+            strbuf_append(&sb, esc_buf) != 0)
+            goto oom_line;
+        for (int i = 0; i < nwords; i++) {
+            if (strlen(words[i]) * 4 + 3 > sizeof(esc_buf)) {
+                fprintf(stderr, "Error: batch line %d: argument too long\n",
+                        cmd_no);
+                free(line);
+                free(sb.data);
+                return NULL;
+            }
+            if (shell_escape(words[i], esc_buf, sizeof(esc_buf)) < 0)
+                goto oom_line;
+            if (strbuf_append(&sb, " ") != 0 ||
+                strbuf_append(&sb, esc_buf) != 0)
+                goto oom_line;
+        }
+
+        /* Status capture + delimiter; rc keeps the first failure */
+        char frame[128];
+        snprintf(frame, sizeof(frame),
+                 "; s=$?; [ \"$rc\" -ne 0 ] || rc=$s; "
+                 "printf -- '--- batch:%d exit:%%d ---\\n' \"$s\"", cmd_no);
+        if (strbuf_append(&sb, frame) != 0) goto oom_line;
+    }
+    free(line);
+    line = NULL;
+
+    if (cmd_no == 0) {
+        fprintf(stderr, "Error: batch: no commands on stdin\n");
+        free(sb.data);
+        return NULL;
+    }
+
+    if (strbuf_append(&sb, "; exit \"$rc\"") != 0) goto oom;
+    return sb.data;
+
+oom_line:
+    free(line);
+oom:
+    fprintf(stderr, "Error: out of memory building batch command\n");
+    free(sb.data);
+    return NULL;
+}
+
 /* ── SSH execution ───────────────────────────────────────────────── */
 
 /*
@@ -457,13 +786,20 @@ static void print_usage(void)
     printf("  read <file> [options]            Read messages\n");
     printf("  poll <file> <handle> [options]   Wait for new message\n");
     printf("  participants <file>              List participants and counts\n");
+    printf("  batch                            Run commands from stdin (one per\n");
+    printf("                                   line) in a single SSH round trip;\n");
+    printf("                                   outputs are separated by\n");
+    printf("                                   '--- batch:<n> exit:<code> ---' lines\n");
     printf("  help                             Show this help\n\n");
     printf("Environment variables:\n");
     printf("  NBS_CHAT_HOST  (required) SSH target, e.g. user@server\n");
     printf("  NBS_CHAT_PORT  (optional) SSH port (default: 22)\n");
     printf("  NBS_CHAT_KEY   (optional) Path to SSH identity file\n");
     printf("  NBS_CHAT_BIN   (optional) Remote nbs-chat path (default: nbs-chat)\n");
-    printf("  NBS_CHAT_OPTS  (optional) Comma-separated SSH -o options\n\n");
+    printf("  NBS_CHAT_OPTS  (optional) Comma-separated SSH -o options\n");
+    printf("  NBS_CHAT_MUX   (optional) Seconds to keep the multiplexed SSH\n");
+    printf("                 connection alive between commands (default: 60;\n");
+    printf("                 0 or off disables connection reuse)\n\n");
     printf("All commands are executed on the remote machine via SSH.\n");
     printf("File paths refer to paths on the remote machine.\n\n");
     printf("Exit codes:\n");
@@ -501,7 +837,20 @@ int main(int argc, char **argv)
     /* Build SSH command with shell-escaped arguments */
     char *opts_buf = NULL;
     char *port_str_heap = NULL;
-    char **ssh_argv = build_ssh_argv(&cfg, argc, argv, &opts_buf, &port_str_heap);
+    char **ssh_argv;
+    if (strcmp(argv[1], "batch") == 0) {
+        /* Batch mode: one nbs-chat command per stdin line, one round trip */
+        if (argc != 2) {
+            fprintf(stderr, "Usage: nbs-chat-remote batch  (commands on stdin)\n");
+            return 4;
+        }
+        char *batch_cmd = build_batch_remote_cmd(&cfg, stdin);
+        if (!batch_cmd) return 4;
+        ssh_argv = assemble_ssh_argv(&cfg, batch_cmd, &opts_buf, &port_str_heap);
+        if (!ssh_argv) free(batch_cmd);
+    } else {
+        ssh_argv = build_ssh_argv(&cfg, argc, argv, &opts_buf, &port_str_heap);
+    }
     if (!ssh_argv) {
         fprintf(stderr, "Error: Failed to allocate SSH command\n");
         return 1;
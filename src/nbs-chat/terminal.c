@@ -114,6 +114,11 @@ static const char *get_colour(const char *handle) {
 static const char *g_chat_file = NULL;
 static const char *g_handle = NULL;
 static int g_msg_count = 0;
+static int64_t g_file_len = -1; /* end_offset of the last parse; -1 = unknown.
+                                   Kept in lockstep with g_msg_count: the pair
+                                   means "g_msg_count messages end at byte
+                                   g_file_len", which is what makes tail-only
+                                   refresh sound. */
 static volatile sig_atomic_t g_quit = 0;
 
 /* Cursor row tracking for wrapped-line redraw */
@@ -566,23 +571,50 @@ static const char *strcasestr_portable(const char *haystack, const char *needle)
 /*
  * Check for new messages and display them without disrupting user input.
  * Only clears and redraws when messages from others actually arrive.
+ *
+ * Incremental on both axes: a single stat against g_file_len skips
+ * untouched files entirely (the common case every POLL_INTERVAL_MS,
+ * and the one that used to stutter typing on big chats), and when the
+ * file did grow only the bytes past g_file_len are read and decoded
+ * via chat_read_from. A full reparse happens only when the tail offset
+ * is unusable (file rewritten or truncated under us).
  */
 static void poll_and_display(line_state_t *ls, const char *handle) {
     ASSERT_MSG(g_chat_file != NULL, "poll_and_display: g_chat_file is NULL");
     ASSERT_MSG(g_msg_count >= 0,
                "poll_and_display: g_msg_count negative: %d", g_msg_count);
 
+    /* Untouched file: one stat, no parse, no redraw */
+    struct stat st;
+    if (g_file_len >= 0 && stat(g_chat_file, &st) == 0 &&
+        (int64_t)st.st_size == g_file_len)
+        return;
+
     chat_state_t state;
-    if (chat_read(g_chat_file, &state) < 0) return;
+    int tail = 0; /* 1 = state holds only messages past g_file_len */
+    if (g_file_len >= 0) {
+        int rc = chat_read_from(g_chat_file, g_file_len, &state);
+        if (rc < 0) return;
+        if (rc == 0)
+            tail = 1;
+        /* rc == 1: offset unusable (rewrite/truncate) — full read below */
+    }
+    if (!tail) {
+        if (chat_read(g_chat_file, &state) < 0) return;
+    }
 
-    if (state.message_count <= g_msg_count) {
+    int first_new = tail ? 0 : g_msg_count;
+    if (state.message_count <= first_new) {
+        /* Nothing new (or the file shrank) — resynchronise and bail */
+        if (!tail) g_msg_count = state.message_count;
+        g_file_len = state.end_offset;
         chat_state_free(&state);
         return;
     }
 
     /* Check if any new messages are from others */
     int has_new_from_others = 0;
-    for (int i = g_msg_count; i < state.message_count; i++) {
+    for (int i = first_new; i < state.message_count; i++) {
         if (strcmp(state.messages[i].handle, g_handle) != 0) {
             has_new_from_others = 1;
             break;
@@ -590,7 +622,9 @@ static void poll_and_display(line_state_t *ls, const char *handle) {
     }
 
     if (!has_new_from_others) {
-        g_msg_count = state.message_count;
+        g_msg_count = tail ? g_msg_count + state.message_count
+                           : state.message_count;
+        g_file_len = state.end_offset;
         chat_state_free(&state);
         return;
     }
@@ -601,15 +635,17 @@ static void poll_and_display(line_state_t *ls, const char *handle) {
     }
     printf("\r\033[J");
 
-    /* Display new messages from others */
-    for (int i = g_msg_count; i < state.message_count; i++) {
+    /* Emit only the new lines — older output is already on screen */
+    for (int i = first_new; i < state.message_count; i++) {
         if (strcmp(state.messages[i].handle, g_handle) == 0) continue;
         format_message(state.messages[i].handle,
                       state.messages[i].content, g_handle,
                       state.messages[i].timestamp);
     }
 
-    g_msg_count = state.message_count;
+    g_msg_count = tail ? g_msg_count + state.message_count
+                       : state.message_count;
+    g_file_len = state.end_offset;
     chat_state_free(&state);
 
     /* Restore prompt and user input — cursor starts from fresh line */
@@ -624,15 +660,12 @@ static void send_and_display(line_state_t *ls) {
     ASSERT_MSG(ls->len > 0, "send_and_display: called with empty buffer");
 
     if (chat_send(g_chat_file, g_handle, ls->buf) == 0) {
-        /* HARDENING NOTE: g_msg_count is incremented optimistically here
-         * under the assumption that chat_send returning 0 means the message
-         * was durably written.  If the file was concurrently truncated or
-         * the write was only partially flushed, this count could diverge
-         * from the actual message count.  The next poll_and_display call
-         * will reconcile via chat_read, so the window of inconsistency
-         * is bounded by POLL_INTERVAL_MS.  A postcondition check here
-         * would require a redundant chat_read, which is too expensive. */
-        g_msg_count++;
+        /* g_msg_count and g_file_len are NOT updated here: the pair must
+         * move in lockstep and chat_send does not report the new length.
+         * The next poll_and_display tail-reads from g_file_len, sees our
+         * own message, skips displaying it (handle check) and advances
+         * both counters consistently — a few bytes of decode, not the
+         * full reparse the old optimistic increment was avoiding. */
         /* Publish bus events: standard chat-message + human-input priority signal */
         bus_bridge_after_send(g_chat_file, g_handle, ls->buf);
         bus_bridge_human_input(g_chat_file, g_handle, ls->buf);
@@ -886,6 +919,7 @@ int main(int argc, char **argv) {
                           init_state.messages[i].timestamp);
         }
         g_msg_count = init_state.message_count;
+        g_file_len = init_state.end_offset;
         if (init_state.message_count > 0) printf("\n");
         chat_state_free(&init_state);
     }
@@ -1008,7 +1042,9 @@ int main(int argc, char **argv) {
                      * does not provide.  Flagged for future cleanup. */
                     if (chat_send(g_chat_file, g_handle, msg) == 0) {
                         format_message(g_handle, msg, g_handle, time(NULL));
-                        g_msg_count++;
+                        /* No g_msg_count++ here: the poll below updates
+                         * g_msg_count and g_file_len together, same as
+                         * send_and_display(). */
                         /* Publish bus events: standard chat-message + human-input priority signal */
                         bus_bridge_after_send(g_chat_file, g_handle, msg);
                         bus_bridge_human_input(g_chat_file, g_handle, msg);
@@ -194,7 +194,7 @@ ACTUAL_LENGTH=$(wc -c < "$CHAT")
 check "file-length matches wc -c" "$( [[ "$HEADER_LENGTH" -eq "$ACTUAL_LENGTH" ]] && echo pass || echo fail )"
 
 # Header fields updated
-LAST_WRITER=$(grep '^last-writer:' "$CHAT" | sed 's/^last-writer:[[:space:]]*//')
+LAST_WRITER=$(grep '^last-writer:' "$CHAT" | sed 's/^last-writer:[[:space:]]*//; s/[[:space:]]*$//')
 check "last-writer is worker-b" "$( [[ "$LAST_WRITER" == "worker-b" ]] && echo pass || echo fail )"
 
 PARTICIPANTS=$(grep '^participants:' "$CHAT" | sed 's/^participants:[[:space:]]*//')
@@ -464,10 +464,11 @@ CORRUPT_CHAT="$TEST_DIR/corrupt.chat"
 PRE_COUNT=$("$NBS_CHAT" read "$CORRUPT_CHAT" | wc -l)
 check "Pre-corruption: 3 messages" "$( [[ "$PRE_COUNT" -eq 3 ]] && echo pass || echo fail )"
 
-# Corrupt the middle base64 line by replacing it with invalid base64
-# The chat file has a header (5 lines + ---) then base64 lines
-# Replace the second base64 line with garbage
-sed -i '8s/.*/!!!!CORRUPT_NOT_BASE64!!!!/' "$CORRUPT_CHAT"
+# Corrupt the middle base64 line by replacing it with invalid base64.
+# The base64 lines start after the "---" separator; find it rather than
+# hardcoding a line number so header layout changes don't shift the target.
+SEP_LINE=$(grep -n '^---$' "$CORRUPT_CHAT" | head -1 | cut -d: -f1)
+sed -i "$((SEP_LINE + 2))s/.*/!!!!CORRUPT_NOT_BASE64!!!!/" "$CORRUPT_CHAT"
 
 # Update file-length header to match new file size (required for integrity check)
 NEW_SIZE=$(wc -c < "$CORRUPT_CHAT")
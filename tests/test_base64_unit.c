@@ -689,6 +689,33 @@ static void test_assertion_ordering_valid_inputs(void) {
     TEST_PASS("assertion ordering: all valid inputs pass without assertion failure");
 }
 
+/* --- Test invalid bytes deep inside a bulk-sized input --- */
+
+static void test_invalid_char_in_bulk_region(void) {
+    /* Large enough that the vectorized kernels (when present) own the
+     * region containing the bad byte; they must stop there and the
+     * scalar validation must still reject with -1 */
+    char enc[129];
+    unsigned char output[128];
+
+    memset(enc, 'A', 128);
+    enc[128] = '\0';
+
+    enc[64] = '!';
+    int ret = base64_decode(enc, 128, output, sizeof(output));
+    TEST_ASSERT(ret == -1, "invalid char at 64: expected -1, got %d", ret);
+
+    enc[64] = '=';  /* padding outside the final block */
+    ret = base64_decode(enc, 128, output, sizeof(output));
+    TEST_ASSERT(ret == -1, "mid-input padding: expected -1, got %d", ret);
+
+    enc[64] = 'A';
+    ret = base64_decode(enc, 128, output, sizeof(output));
+    TEST_ASSERT(ret == 96, "repaired input: expected 96, got %d", ret);
+
+    TEST_PASS("invalid bytes in bulk region rejected");
+}
+
 int main(void) {
     printf("=== base64 unit tests ===\n\n");
 
@@ -711,6 +738,7 @@ int main(void) {
     test_thread_safety_decode_table();
     test_empty_input_postcondition();
     test_assertion_ordering_valid_inputs();
+    test_invalid_char_in_bulk_region();
 
     printf("\n=== Results: %d passed, %d failed ===\n",
            tests_passed, tests_failed);
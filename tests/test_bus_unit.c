@@ -18,10 +18,12 @@
  *       -I../src/nbs-bus -o test_bus_unit test_bus_unit.c ../src/nbs-bus/bus.c
  */
 
+#include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <limits.h>
 #include <errno.h>
@@ -332,10 +334,530 @@ static void test_dedup_window_overflow_guard(void) {
     TEST_PASS("integer overflow guard on dedup_window_s * 1000000LL");
 }
 
+/* --- Test 10: batch publish creates every event with unique names --- */
+
+static void test_publish_batch_creates_all_events(void) {
+    char events_dir[BUS_MAX_FULLPATH];
+    TEST_ASSERT(make_temp_events_dir(events_dir, sizeof(events_dir)) == 0,
+                "failed to create temp events dir");
+
+    /* Two events share source and type — the batch must still give them
+     * distinct filenames (strictly increasing timestamps). */
+    bus_batch_event_t batch[3] = {
+        { "tester", "chat-message",  BUS_PRIORITY_NORMAL, "one" },
+        { "tester", "chat-mention",  BUS_PRIORITY_HIGH,   "two" },
+        { "tester", "chat-mention",  BUS_PRIORITY_HIGH,   "three" },
+    };
+
+    bus_set_quiet(1);
+    int rc = bus_publish_batch(events_dir, batch, 3);
+    bus_set_quiet(0);
+    TEST_ASSERT(rc == 0, "bus_publish_batch failed: %d", rc);
+
+    /* Count the .event files */
+    int count = 0;
+    DIR *dir = opendir(events_dir);
+    TEST_ASSERT(dir != NULL, "opendir failed: %s", strerror(errno));
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t nlen = strlen(entry->d_name);
+        if (nlen > 6 && strcmp(entry->d_name + nlen - 6, ".event") == 0)
+            count++;
+    }
+    closedir(dir);
+    TEST_ASSERT(count == 3, "expected 3 event files, found %d", count);
+
+    remove_temp_dir(events_dir);
+    TEST_PASS("publish_batch creates all events with distinct filenames");
+}
+
+/* --- Test 11: batch publish rejects a bad entry before writing --- */
+
+static void test_publish_batch_validates_before_writing(void) {
+    char events_dir[BUS_MAX_FULLPATH];
+    TEST_ASSERT(make_temp_events_dir(events_dir, sizeof(events_dir)) == 0,
+                "failed to create temp events dir");
+
+    /* Second event has whitespace in its type — the whole batch must be
+     * rejected with nothing published. */
+    bus_batch_event_t batch[2] = {
+        { "tester", "good-type", BUS_PRIORITY_NORMAL, "ok" },
+        { "tester", "bad type",  BUS_PRIORITY_NORMAL, "nope" },
+    };
+
+    bus_set_quiet(1);
+    int rc = bus_publish_batch(events_dir, batch, 2);
+    bus_set_quiet(0);
+    TEST_ASSERT(rc == -1, "bus_publish_batch should fail, got %d", rc);
+
+    int count = 0;
+    DIR *dir = opendir(events_dir);
+    TEST_ASSERT(dir != NULL, "opendir failed: %s", strerror(errno));
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t nlen = strlen(entry->d_name);
+        if (nlen > 6 && strcmp(entry->d_name + nlen - 6, ".event") == 0)
+            count++;
+    }
+    closedir(dir);
+    TEST_ASSERT(count == 0, "invalid batch published %d event(s)", count);
+
+    remove_temp_dir(events_dir);
+    TEST_PASS("publish_batch validates every entry before writing any");
+}
+
+/* --- Test 12: wait returns immediately when a match is pending --- */
+
+static void test_wait_immediate_and_timeout(void) {
+    char events_dir[BUS_MAX_FULLPATH];
+    TEST_ASSERT(make_temp_events_dir(events_dir, sizeof(events_dir)) == 0,
+                "failed to create temp events dir");
+
+    bus_set_quiet(1);
+    TEST_ASSERT(bus_publish(events_dir, "agent-a", "task-done",
+                            BUS_PRIORITY_NORMAL, "done") == 0,
+                "publish failed");
+    bus_set_quiet(0);
+
+    /* Matching event already pending: returns 0 without blocking */
+    int rc = bus_wait(events_dir, "agent-a", 0);
+    TEST_ASSERT(rc == 0, "wait with pending match returned %d", rc);
+
+    /* No event from agent-b: timeout (exit code 3), even with timeout 0 */
+    rc = bus_wait(events_dir, "agent-b", 0);
+    TEST_ASSERT(rc == BUS_EXIT_NOT_FOUND,
+                "wait with no match returned %d, expected %d",
+                rc, BUS_EXIT_NOT_FOUND);
+
+    remove_temp_dir(events_dir);
+    TEST_PASS("wait returns immediately on match, 3 on timeout");
+}
+
+/* --- Test 13: wait wakes when a matching event is published --- */
+
+static void test_wait_wakes_on_publish(void) {
+    char events_dir[BUS_MAX_FULLPATH];
+    TEST_ASSERT(make_temp_events_dir(events_dir, sizeof(events_dir)) == 0,
+                "failed to create temp events dir");
+
+    pid_t pid = fork();
+    TEST_ASSERT(pid >= 0, "fork failed: %s", strerror(errno));
+    if (pid == 0) {
+        /* Child: publish a matching event shortly after the parent blocks */
+        usleep(300 * 1000);
+        bus_set_quiet(1);
+        int rc = bus_publish(events_dir, "waker", "ping",
+                             BUS_PRIORITY_HIGH, "wake up");
+        _exit(rc == 0 ? 0 : 1);
+    }
+
+    time_t start = time(NULL);
+    int rc = bus_wait(events_dir, "waker", 10);
+    time_t elapsed = time(NULL) - start;
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                "child publish failed");
+    TEST_ASSERT(rc == 0, "wait returned %d, expected 0", rc);
+    /* Event-driven wait should return well inside the 10 s timeout */
+    TEST_ASSERT(elapsed < 5, "wait took %lds — not event-driven?",
+                (long)elapsed);
+
+    remove_temp_dir(events_dir);
+    TEST_PASS("wait wakes promptly when a matching event lands");
+}
+
 /* ================================================================== */
 /* Main test runner                                                    */
 /* ================================================================== */
 
+/* --- Test 14: journal queue format publish/scan/ack cycle --- */
+
+/* Write config.yaml selecting the journal queue format */
+static void enable_journal_mode(const char *events_dir)
+{
+    char path[BUS_MAX_FULLPATH];
+    snprintf(path, sizeof(path), "%s/config.yaml", events_dir);
+    FILE *fp = fopen(path, "w");
+    if (fp) {
+        fputs("queue-format: journal\n", fp);
+        fclose(fp);
+    }
+}
+
+/* Parse the nth record's virtual filename and flags straight from the
+ * journal file — validates the on-disk framing independently of the
+ * library's own reader. Returns 0 on success. */
+static int read_journal_record(const char *events_dir, int index,
+                               char *fname, size_t fname_len,
+                               unsigned char *flags_out)
+{
+    char path[BUS_MAX_FULLPATH];
+    snprintf(path, sizeof(path), "%s/%s", events_dir, BUS_JOURNAL_FILE);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+
+    int rc = -1;
+    for (int i = 0; ; i++) {
+        unsigned char hdr[5];
+        if (fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) break;
+        unsigned int clen = (unsigned int)hdr[0] | ((unsigned int)hdr[1] << 8) |
+                            ((unsigned int)hdr[2] << 16) |
+                            ((unsigned int)hdr[3] << 24);
+        if (i == index) {
+            char line[BUS_MAX_FILENAME + 8];
+            if (fgets(line, sizeof(line), fp) &&
+                strncmp(line, "file: ", 6) == 0) {
+                char *nl = strchr(line + 6, '\n');
+                if (nl) *nl = '\0';
+                snprintf(fname, fname_len, "%s", line + 6);
+                *flags_out = hdr[4];
+                rc = 0;
+            }
+            break;
+        }
+        if (fseek(fp, (long)clen, SEEK_CUR) != 0) break;
+    }
+    fclose(fp);
+    return rc;
+}
+
+static void test_journal_publish_ack_cycle(void) {
+    char events_dir[BUS_MAX_FULLPATH];
+    TEST_ASSERT(make_temp_events_dir(events_dir, sizeof(events_dir)) == 0,
+                "failed to create temp events dir");
+    enable_journal_mode(events_dir);
+
+    bus_set_quiet(1);
+    TEST_ASSERT(bus_publish(events_dir, "alice", "task", BUS_PRIORITY_NORMAL,
+                            "one") == 0, "journal publish 1 failed");
+    TEST_ASSERT(bus_publish(events_dir, "bob", "alert", BUS_PRIORITY_CRITICAL,
+                            "two") == 0, "journal publish 2 failed");
+    TEST_ASSERT(bus_publish(events_dir, "alice", "task", BUS_PRIORITY_LOW,
+                            NULL) == 0, "journal publish 3 failed");
+    bus_set_quiet(0);
+
+    /* No per-event files — everything lands in the journal */
+    int event_files = 0;
+    DIR *dir = opendir(events_dir);
+    TEST_ASSERT(dir != NULL, "opendir failed: %s", strerror(errno));
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t nlen = strlen(entry->d_name);
+        if (nlen > 6 && strcmp(entry->d_name + nlen - 6, ".event") == 0)
+            event_files++;
+    }
+    closedir(dir);
+    TEST_ASSERT(event_files == 0,
+                "journal mode wrote %d .event files", event_files);
+
+    char f0[BUS_MAX_FILENAME], f1[BUS_MAX_FILENAME];
+    unsigned char flags = 0xff;
+    TEST_ASSERT(read_journal_record(events_dir, 0, f0, sizeof(f0), &flags) == 0,
+                "cannot parse journal record 0");
+    TEST_ASSERT(flags == 0, "fresh record 0 not pending (flags=%d)", flags);
+    TEST_ASSERT(read_journal_record(events_dir, 1, f1, sizeof(f1), &flags) == 0,
+                "cannot parse journal record 1");
+
+    /* Ack the second record: it gets flagged but the cursor stays at 0
+     * because record 0 is still pending */
+    TEST_ASSERT(bus_ack(events_dir, f1) == 0, "journal ack failed");
+    TEST_ASSERT(read_journal_record(events_dir, 1, f1, sizeof(f1), &flags) == 0,
+                "cannot re-parse journal record 1");
+    TEST_ASSERT(flags == 1, "acked record 1 not flagged (flags=%d)", flags);
+
+    /* Acking the first record lets the cursor advance past both */
+    TEST_ASSERT(bus_ack(events_dir, f0) == 0, "journal ack of head failed");
+    char base_path[BUS_MAX_FULLPATH];
+    snprintf(base_path, sizeof(base_path), "%s/%s",
+             events_dir, BUS_JOURNAL_BASE_FILE);
+    long long base = 0;
+    FILE *fp = fopen(base_path, "r");
+    TEST_ASSERT(fp != NULL, "journal.base missing after head ack");
+    TEST_ASSERT(fscanf(fp, "offset: %lld", &base) == 1 && base > 0,
+                "cursor did not advance (offset %lld)", base);
+    fclose(fp);
+
+    /* Acking an unknown filename fails like a missing event file */
+    TEST_ASSERT(bus_ack(events_dir, "12345-x-y-1.event") == -1,
+                "ack of unknown journal record should fail");
+
+    remove_temp_dir(events_dir);
+    TEST_PASS("journal mode: publish appends records, acks advance cursor");
+}
+
+/* --- Test 15: bus_wait wakes on a journal append --- */
+
+static void test_journal_wait_wakes(void) {
+    char events_dir[BUS_MAX_FULLPATH];
+    TEST_ASSERT(make_temp_events_dir(events_dir, sizeof(events_dir)) == 0,
+                "failed to create temp events dir");
+    enable_journal_mode(events_dir);
+
+    pid_t pid = fork();
+    TEST_ASSERT(pid >= 0, "fork failed: %s", strerror(errno));
+    if (pid == 0) {
+        usleep(300 * 1000);
+        bus_set_quiet(1);
+        bus_publish(events_dir, "waker", "ping", BUS_PRIORITY_NORMAL, NULL);
+        _exit(0);
+    }
+
+    time_t start = time(NULL);
+    int rc = bus_wait(events_dir, "waker", 10);
+    time_t elapsed = time(NULL) - start;
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    TEST_ASSERT(rc == 0, "bus_wait on journal returned %d", rc);
+    TEST_ASSERT(elapsed < 5, "bus_wait took %lds — inotify wake missed",
+                (long)elapsed);
+
+    remove_temp_dir(events_dir);
+    TEST_PASS("journal mode: wait wakes when a record is appended");
+}
+
+/* --- Test 16: dedup ledger answers repeat heartbeats without a scan --- */
+
+static void test_dedup_ledger(void) {
+    char events_dir[BUS_MAX_FULLPATH];
+    TEST_ASSERT(make_temp_events_dir(events_dir, sizeof(events_dir)) == 0,
+                "failed to create temp events dir");
+    bus_set_quiet(1);
+
+    long long window_us = 60LL * 1000000LL;
+    int rc = bus_publish_dedup(events_dir, "hb", "heartbeat",
+                               BUS_PRIORITY_NORMAL, NULL, window_us);
+    TEST_ASSERT(rc == 0, "first dedup publish returned %d", rc);
+
+    /* The publish must have recorded its key in the ledger */
+    char ledger_path[BUS_MAX_FULLPATH];
+    snprintf(ledger_path, sizeof(ledger_path), "%s/.dedup", events_dir);
+    struct stat st;
+    TEST_ASSERT(stat(ledger_path, &st) == 0 && st.st_size > 0,
+                "dedup ledger %s missing after publish", ledger_path);
+
+    /* Second publish within the window is a duplicate */
+    rc = bus_publish_dedup(events_dir, "hb", "heartbeat",
+                           BUS_PRIORITY_NORMAL, NULL, window_us);
+    TEST_ASSERT(rc == BUS_EXIT_DEDUP,
+                "duplicate within window returned %d, want %d",
+                rc, BUS_EXIT_DEDUP);
+
+    /* A different key is unaffected by hb:heartbeat's ledger entry */
+    rc = bus_publish_dedup(events_dir, "hb", "status",
+                           BUS_PRIORITY_NORMAL, NULL, window_us);
+    TEST_ASSERT(rc == 0, "distinct key dedup publish returned %d", rc);
+
+    /* Ack everything: the ledger entry is now stale (event no longer
+     * pending), so the next publish must go through */
+    TEST_ASSERT(bus_ack_all(events_dir, NULL) == 0, "ack_all failed");
+    rc = bus_publish_dedup(events_dir, "hb", "heartbeat",
+                           BUS_PRIORITY_NORMAL, NULL, window_us);
+    TEST_ASSERT(rc == 0,
+                "publish after ack returned %d — stale ledger entry "
+                "suppressed a live event", rc);
+
+    remove_temp_dir(events_dir);
+    TEST_PASS("dedup ledger: O(1) duplicate detection, stale entries ignored");
+}
+
+/* --- Test 17: processed-size cache tracks acks and survives staleness --- */
+
+static void test_processed_stats_cache(void) {
+    char events_dir[BUS_MAX_FULLPATH];
+    TEST_ASSERT(make_temp_events_dir(events_dir, sizeof(events_dir)) == 0,
+                "failed to create temp events dir");
+    bus_set_quiet(1);
+
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT(bus_publish(events_dir, "src", "evt",
+                                BUS_PRIORITY_NORMAL, "hello") == 0,
+                    "publish %d failed", i);
+    TEST_ASSERT(bus_ack_all(events_dir, NULL) == 0, "ack_all failed");
+
+    /* A generous prune seeds/refreshes the cache from a real scan */
+    TEST_ASSERT(bus_prune(events_dir, 1024LL * 1024LL) == 0, "prune failed");
+
+    char stats_path[BUS_MAX_FULLPATH];
+    snprintf(stats_path, sizeof(stats_path), "%s/.stats", events_dir);
+    FILE *fp = fopen(stats_path, "r");
+    TEST_ASSERT(fp != NULL, "stats cache %s missing after prune", stats_path);
+    long long sig = 0, count = 0, bytes = 0;
+    int got = fscanf(fp, "processed-sig: %lld\nprocessed-count: %lld\n"
+                         "processed-bytes: %lld\n", &sig, &count, &bytes);
+    fclose(fp);
+    TEST_ASSERT(got == 3, "stats cache malformed (parsed %d fields)", got);
+    TEST_ASSERT(count == 3, "cached count %lld, want 3", count);
+    TEST_ASSERT(bytes > 0, "cached bytes %lld, want > 0", bytes);
+
+    /* An ack folds its file into the cache without a scan */
+    TEST_ASSERT(bus_publish(events_dir, "src", "evt",
+                            BUS_PRIORITY_NORMAL, "hello") == 0,
+                "fourth publish failed");
+    TEST_ASSERT(bus_ack_all(events_dir, NULL) == 0, "second ack_all failed");
+    fp = fopen(stats_path, "r");
+    TEST_ASSERT(fp != NULL, "stats cache vanished after ack");
+    got = fscanf(fp, "processed-sig: %lld\nprocessed-count: %lld\n"
+                     "processed-bytes: %lld\n", &sig, &count, &bytes);
+    fclose(fp);
+    TEST_ASSERT(got == 3 && count == 4,
+                "cached count after ack is %lld, want 4", count);
+
+    /* Corrupt the cache with absurd counters but a stale signature:
+     * status must fall back to the scan and prune must not trust it */
+    fp = fopen(stats_path, "w");
+    TEST_ASSERT(fp != NULL, "cannot rewrite stats cache");
+    fprintf(fp, "processed-sig: 1\nprocessed-count: 999\n"
+                "processed-bytes: 999999999\n");
+    fclose(fp);
+    TEST_ASSERT(bus_prune(events_dir, 1024LL * 1024LL) == 0,
+                "prune with stale cache failed");
+    fp = fopen(stats_path, "r");
+    TEST_ASSERT(fp != NULL, "stats cache missing after rebuild");
+    got = fscanf(fp, "processed-sig: %lld\nprocessed-count: %lld\n"
+                     "processed-bytes: %lld\n", &sig, &count, &bytes);
+    fclose(fp);
+    TEST_ASSERT(got == 3 && count == 4,
+                "stale cache not rebuilt from scan: count %lld, want 4", count);
+
+    remove_temp_dir(events_dir);
+    TEST_PASS("processed-size cache: acks fold in, stale entries rescan");
+}
+
+/* --- Test 18: streamed publish copies the payload without staging it --- */
+
+static void test_publish_stream_payload(void) {
+    char events_dir[BUS_MAX_FULLPATH];
+    TEST_ASSERT(make_temp_events_dir(events_dir, sizeof(events_dir)) == 0,
+                "failed to create temp events dir");
+    bus_set_quiet(1);
+
+    /* A payload well past the old 16 KB argv comfort zone, with embedded
+     * newlines and no final one — publish must indent every line and
+     * supply the terminator */
+    size_t big_len = 64 * 1024;
+    char *big = malloc(big_len + 1);
+    TEST_ASSERT(big != NULL, "payload alloc failed");
+    for (size_t i = 0; i < big_len; i++)
+        big[i] = (i % 80 == 79) ? '\n' : (char)('a' + (i % 26));
+    big[big_len] = '\0'; /* last line has no trailing newline */
+
+    char spool[BUS_MAX_FULLPATH];
+    snprintf(spool, sizeof(spool), "%s/payload.in", events_dir);
+    FILE *fp = fopen(spool, "w");
+    TEST_ASSERT(fp != NULL, "cannot write payload spool");
+    fwrite(big, 1, big_len, fp);
+    fclose(fp);
+
+    fp = fopen(spool, "r");
+    TEST_ASSERT(fp != NULL, "cannot reopen payload spool");
+    TEST_ASSERT(bus_publish_stream(events_dir, "src", "result",
+                                   BUS_PRIORITY_NORMAL, fp) == 0,
+                "streamed publish failed");
+    fclose(fp);
+
+    /* Find the event file and check the payload round-tripped with the
+     * block-scalar indent on every line */
+    DIR *dir = opendir(events_dir);
+    TEST_ASSERT(dir != NULL, "opendir failed: %s", strerror(errno));
+    char event_name[BUS_MAX_FILENAME] = "";
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t nlen = strlen(entry->d_name);
+        if (nlen > 6 && strcmp(entry->d_name + nlen - 6, ".event") == 0)
+            snprintf(event_name, sizeof(event_name), "%s", entry->d_name);
+    }
+    closedir(dir);
+    TEST_ASSERT(event_name[0] != '\0', "no event file published");
+
+    char event_path[BUS_MAX_FULLPATH];
+    snprintf(event_path, sizeof(event_path), "%s/%s", events_dir, event_name);
+    fp = fopen(event_path, "r");
+    TEST_ASSERT(fp != NULL, "cannot open published event");
+    char line[256];
+    int saw_payload_key = 0;
+    size_t payload_bytes = 0;
+    int bad_indent = 0;
+    char last_line_char = '\0';
+    while (fgets(line, sizeof(line), fp)) {
+        if (!saw_payload_key) {
+            if (strcmp(line, "payload: |\n") == 0)
+                saw_payload_key = 1;
+            continue;
+        }
+        size_t llen = strlen(line);
+        if (payload_bytes == 0 || last_line_char == '\n') {
+            if (strncmp(line, "  ", 2) != 0)
+                bad_indent = 1;
+            payload_bytes += llen > 2 ? llen - 2 : 0;
+        } else {
+            payload_bytes += llen; /* continuation of a long line */
+        }
+        last_line_char = line[llen - 1];
+    }
+    fclose(fp);
+    TEST_ASSERT(saw_payload_key, "payload block missing from event");
+    TEST_ASSERT(!bad_indent, "payload line missing block-scalar indent");
+    /* big_len bytes plus the supplied final newline */
+    TEST_ASSERT(payload_bytes == big_len + 1,
+                "payload is %zu bytes, want %zu", payload_bytes, big_len + 1);
+
+    /* An empty stream publishes a payload-free event, like payload=NULL */
+    fp = fopen("/dev/null", "r");
+    TEST_ASSERT(fp != NULL, "cannot open /dev/null");
+    TEST_ASSERT(bus_publish_stream(events_dir, "src", "empty",
+                                   BUS_PRIORITY_LOW, fp) == 0,
+                "empty streamed publish failed");
+    fclose(fp);
+
+    free(big);
+    unlink(spool);
+    remove_temp_dir(events_dir);
+    TEST_PASS("streamed publish: chunked copy, indent, final newline");
+}
+
+/* --- Test 19: streamed publish and read in journal mode --- */
+
+static void test_publish_stream_journal(void) {
+    char events_dir[BUS_MAX_FULLPATH];
+    TEST_ASSERT(make_temp_events_dir(events_dir, sizeof(events_dir)) == 0,
+                "failed to create temp events dir");
+    enable_journal_mode(events_dir);
+    bus_set_quiet(1);
+
+    char spool[BUS_MAX_FULLPATH];
+    snprintf(spool, sizeof(spool), "%s/payload.in", events_dir);
+    FILE *fp = fopen(spool, "w");
+    TEST_ASSERT(fp != NULL, "cannot write payload spool");
+    fprintf(fp, "line one\nline two\n");
+    fclose(fp);
+
+    fp = fopen(spool, "r");
+    TEST_ASSERT(fp != NULL, "cannot reopen payload spool");
+    TEST_ASSERT(bus_publish_stream(events_dir, "src", "result",
+                                   BUS_PRIORITY_NORMAL, fp) == 0,
+                "journal streamed publish failed");
+    fclose(fp);
+
+    char fname[BUS_MAX_FILENAME];
+    unsigned char flags = 0xff;
+    TEST_ASSERT(read_journal_record(events_dir, 0, fname, sizeof(fname),
+                                    &flags) == 0,
+                "cannot parse streamed journal record");
+    TEST_ASSERT(flags == 0, "streamed record not pending (flags=%d)", flags);
+    TEST_ASSERT(bus_read(events_dir, fname) == 0,
+                "bus_read of streamed journal record failed");
+    TEST_ASSERT(bus_ack(events_dir, fname) == 0,
+                "ack of streamed journal record failed");
+
+    unlink(spool);
+    remove_temp_dir(events_dir);
+    TEST_PASS("journal mode: streamed publish frames one readable record");
+}
+
 int main(void) {
     printf("=== bus unit tests ===\n\n");
 
@@ -348,6 +870,16 @@ int main(void) {
     test_read_empty_filename();
     test_ack_empty_filename();
     test_dedup_window_overflow_guard();
+    test_publish_batch_creates_all_events();
+    test_publish_batch_validates_before_writing();
+    test_wait_immediate_and_timeout();
+    test_wait_wakes_on_publish();
+    test_journal_publish_ack_cycle();
+    test_journal_wait_wakes();
+    test_dedup_ledger();
+    test_processed_stats_cache();
+    test_publish_stream_payload();
+    test_publish_stream_journal();
 
     printf("\n=== Results: %d passed, %d failed ===\n",
            tests_passed, tests_failed);
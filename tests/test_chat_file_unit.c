@@ -41,6 +41,7 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <time.h>
+#include <sys/wait.h>
 
 /* Include the headers from the source directory */
 #include "chat_file.h"
@@ -990,6 +991,1008 @@ static void test_timestamp_content_with_pipe(void) {
     TEST_PASS("T22e: message with pipes in content parses correctly");
 }
 
+/* --- APPEND FAST PATH tests (T23) --- */
+
+/*
+ * Sequential sends after create should take the append fast path
+ * (padded header). Verify messages, participants, and the file-length
+ * invariant all survive it.
+ */
+static void test_append_fast_path_sequence(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/append_fast.chat", test_dir);
+
+    int rc = chat_create(path);
+    TEST_ASSERT(rc == 0, "chat_create failed: %d", rc);
+
+    for (int i = 0; i < 5; i++) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "message number %d", i);
+        rc = chat_send(path, (i % 2 == 0) ? "alice" : "bob", msg);
+        TEST_ASSERT(rc == 0, "chat_send %d failed: %d", i, rc);
+    }
+
+    chat_state_t state;
+    rc = chat_read(path, &state);
+    TEST_ASSERT(rc == 0, "chat_read failed: %d", rc);
+    TEST_ASSERT(state.message_count == 5,
+                "expected 5 messages, got %d", state.message_count);
+    TEST_ASSERT(strcmp(state.messages[4].content, "message number 4") == 0,
+                "T23a: last message content mismatch: got '%s'",
+                state.messages[4].content);
+    TEST_ASSERT(strcmp(state.last_writer, "alice") == 0,
+                "T23a: last_writer should be 'alice' (no padding), got '%s'",
+                state.last_writer);
+    TEST_ASSERT(state.participant_count == 2,
+                "T23a: expected 2 participants, got %d", state.participant_count);
+
+    /* file-length header must match actual size after fast-path appends */
+    struct stat st;
+    TEST_ASSERT(stat(path, &st) == 0, "stat failed: %s", strerror(errno));
+    TEST_ASSERT(state.file_length == (int64_t)st.st_size,
+                "T23a: file-length header %" PRId64 " != actual size %" PRId64,
+                state.file_length, (int64_t)st.st_size);
+
+    chat_state_free(&state);
+
+    char lock_path[520], cpath[520];
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", path);
+    snprintf(cpath, sizeof(cpath), "%s.cursors", path);
+    cleanup_path(cpath);
+    cleanup_path(lock_path);
+    cleanup_path(path);
+    TEST_PASS("T23a: sequential sends via append fast path keep file consistent");
+}
+
+/*
+ * A legacy (unpadded) header must still be readable and must be
+ * migrated to the padded layout by the next send's full-rewrite path.
+ */
+static void test_append_legacy_migration(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/append_legacy.chat", test_dir);
+
+    /* Hand-write a legacy-format file (self-referential file-length).
+     * "YWxpY2U6IGhp" decodes to "alice: hi". */
+    const char *body =
+        "=== nbs-chat ===\n"
+        "last-writer: alice\n"
+        "last-write: 2026-01-01T00:00:00+0000\n"
+        "file-length: 130\n"
+        "participants: alice(1)\n"
+        "---\n"
+        "YWxpY2U6IGhp\n";
+    FILE *f = fopen(path, "w");
+    TEST_ASSERT(f != NULL, "fopen failed: %s", strerror(errno));
+    fputs(body, f);
+    fclose(f);
+
+    int rc = chat_send(path, "bob", "hello alice");
+    TEST_ASSERT(rc == 0, "chat_send on legacy file failed: %d", rc);
+
+    chat_state_t state;
+    rc = chat_read(path, &state);
+    TEST_ASSERT(rc == 0, "chat_read failed: %d", rc);
+    TEST_ASSERT(state.message_count == 2,
+                "expected 2 messages, got %d", state.message_count);
+    TEST_ASSERT(strcmp(state.messages[0].content, "hi") == 0,
+                "T23b: legacy message content mismatch: got '%s'",
+                state.messages[0].content);
+    TEST_ASSERT(strcmp(state.messages[1].handle, "bob") == 0,
+                "T23b: appended handle mismatch: got '%s'",
+                state.messages[1].handle);
+
+    /* After migration the header is fixed-width, so file-length matches */
+    struct stat st;
+    TEST_ASSERT(stat(path, &st) == 0, "stat failed: %s", strerror(errno));
+    TEST_ASSERT(state.file_length == (int64_t)st.st_size,
+                "T23b: file-length header %" PRId64 " != actual size %" PRId64
+                " after migration", state.file_length, (int64_t)st.st_size);
+    chat_state_free(&state);
+
+    /* A further send should now append (message still readable) */
+    rc = chat_send(path, "alice", "hi again");
+    TEST_ASSERT(rc == 0, "chat_send after migration failed: %d", rc);
+    rc = chat_read(path, &state);
+    TEST_ASSERT(rc == 0, "chat_read failed: %d", rc);
+    TEST_ASSERT(state.message_count == 3,
+                "expected 3 messages, got %d", state.message_count);
+    chat_state_free(&state);
+
+    char lock_path[520], cpath[520];
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", path);
+    snprintf(cpath, sizeof(cpath), "%s.cursors", path);
+    cleanup_path(cpath);
+    cleanup_path(lock_path);
+    cleanup_path(path);
+    TEST_PASS("T23b: legacy header reads, migrates, then appends cleanly");
+}
+
+/* --- EVENT-DRIVEN POLL tests (T24) --- */
+
+/*
+ * chat_poll should wake promptly when another handle writes, well
+ * before the timeout expires. A child process sends after a short
+ * delay while the parent blocks in chat_poll with a generous timeout;
+ * if the event-driven wait works the parent returns long before it.
+ */
+static void test_poll_wakes_on_send(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/poll_wake.chat", test_dir);
+
+    int rc = chat_create(path);
+    TEST_ASSERT(rc == 0, "T24a: chat_create failed: %d", rc);
+
+    pid_t pid = fork();
+    TEST_ASSERT(pid >= 0, "T24a: fork failed: %s", strerror(errno));
+    if (pid == 0) {
+        /* Child: give the parent time to enter chat_poll, then send */
+        usleep(300 * 1000);
+        chat_send(path, "bob", "wake up");
+        _exit(0);
+    }
+
+    time_t start = time(NULL);
+    rc = chat_poll(path, "alice", 10);
+    time_t elapsed = time(NULL) - start;
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    TEST_ASSERT(rc == 0, "T24a: expected 0 (new message), got %d", rc);
+    TEST_ASSERT(elapsed < 5,
+                "T24a: poll took %lds; expected to wake well before timeout",
+                (long)elapsed);
+
+    cleanup_path(path);
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    TEST_PASS("T24a: chat_poll wakes on a send from another handle");
+}
+
+/*
+ * A send from the polling handle itself must not satisfy the poll:
+ * chat_poll only reports messages from other participants, so it
+ * should run out the timeout and return 3.
+ */
+static void test_poll_ignores_own_send(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/poll_self.chat", test_dir);
+
+    int rc = chat_create(path);
+    TEST_ASSERT(rc == 0, "T24b: chat_create failed: %d", rc);
+
+    pid_t pid = fork();
+    TEST_ASSERT(pid >= 0, "T24b: fork failed: %s", strerror(errno));
+    if (pid == 0) {
+        usleep(200 * 1000);
+        chat_send(path, "alice", "talking to myself");
+        _exit(0);
+    }
+
+    rc = chat_poll(path, "alice", 1);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    TEST_ASSERT(rc == 3, "T24b: expected 3 (timeout), got %d", rc);
+
+    cleanup_path(path);
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    TEST_PASS("T24b: chat_poll ignores the caller's own messages");
+}
+
+/* --- INCREMENTAL TAIL READ tests (T25) --- */
+
+/*
+ * chat_read_from with a previous state's end_offset should decode only
+ * the messages written after that point, and report an end_offset equal
+ * to the actual file size.
+ */
+static void test_read_from_tail(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/tail_read.chat", test_dir);
+
+    int rc = chat_create(path);
+    TEST_ASSERT(rc == 0, "T25a: chat_create failed: %d", rc);
+    TEST_ASSERT(chat_send(path, "alice", "one") == 0, "T25a: send 1 failed");
+    TEST_ASSERT(chat_send(path, "bob", "two") == 0, "T25a: send 2 failed");
+    TEST_ASSERT(chat_send(path, "alice", "three") == 0, "T25a: send 3 failed");
+
+    chat_state_t full;
+    rc = chat_read(path, &full);
+    TEST_ASSERT(rc == 0, "T25a: chat_read failed: %d", rc);
+    TEST_ASSERT(full.message_count == 3,
+                "T25a: expected 3 messages, got %d", full.message_count);
+    int64_t mark = full.end_offset;
+    TEST_ASSERT(mark > 0, "T25a: end_offset not set: %" PRId64, mark);
+    chat_state_free(&full);
+
+    TEST_ASSERT(chat_send(path, "bob", "four") == 0, "T25a: send 4 failed");
+    TEST_ASSERT(chat_send(path, "carol", "five") == 0, "T25a: send 5 failed");
+
+    chat_state_t tail;
+    rc = chat_read_from(path, mark, &tail);
+    TEST_ASSERT(rc == 0, "T25a: chat_read_from failed: %d", rc);
+    TEST_ASSERT(tail.message_count == 2,
+                "T25a: expected 2 tail messages, got %d", tail.message_count);
+    TEST_ASSERT(strcmp(tail.messages[0].handle, "bob") == 0,
+                "T25a: tail[0] handle '%s' != 'bob'", tail.messages[0].handle);
+    TEST_ASSERT(strcmp(tail.messages[1].content, "five") == 0,
+                "T25a: tail[1] content '%s' != 'five'", tail.messages[1].content);
+    /* Header fields are still populated on a tail read */
+    TEST_ASSERT(strcmp(tail.last_writer, "carol") == 0,
+                "T25a: last_writer '%s' != 'carol'", tail.last_writer);
+
+    struct stat st;
+    TEST_ASSERT(stat(path, &st) == 0, "T25a: stat failed");
+    TEST_ASSERT(tail.end_offset == (int64_t)st.st_size,
+                "T25a: end_offset %" PRId64 " != file size %" PRId64,
+                tail.end_offset, (int64_t)st.st_size);
+    chat_state_free(&tail);
+
+    cleanup_path(path);
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    TEST_PASS("T25a: chat_read_from decodes only the tail");
+}
+
+/*
+ * Stale or misaligned offsets must be rejected with 1 (caller falls
+ * back to a full read), never silently misparsed.
+ */
+static void test_read_from_stale_offset(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/tail_stale.chat", test_dir);
+
+    int rc = chat_create(path);
+    TEST_ASSERT(rc == 0, "T25b: chat_create failed: %d", rc);
+    TEST_ASSERT(chat_send(path, "alice", "hello") == 0, "T25b: send failed");
+
+    struct stat st;
+    TEST_ASSERT(stat(path, &st) == 0, "T25b: stat failed");
+
+    chat_state_t state;
+    /* Past EOF (file was truncated/replaced since the cursor was taken) */
+    rc = chat_read_from(path, (int64_t)st.st_size + 10, &state);
+    TEST_ASSERT(rc == 1, "T25b: past-EOF offset: expected 1, got %d", rc);
+
+    /* Mid-line: not on a line boundary */
+    rc = chat_read_from(path, (int64_t)st.st_size - 3, &state);
+    TEST_ASSERT(rc == 1, "T25b: mid-line offset: expected 1, got %d", rc);
+
+    /* Inside the header */
+    rc = chat_read_from(path, 0, &state);
+    TEST_ASSERT(rc == 1, "T25b: in-header offset: expected 1, got %d", rc);
+
+    cleanup_path(path);
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    TEST_PASS("T25b: chat_read_from rejects stale offsets");
+}
+
+/*
+ * Cursor byte offsets round-trip through the cursor file, and legacy
+ * "handle=index" entries (no offset) still parse with offset -1.
+ */
+static void test_cursor_offset_roundtrip(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/cursor_pos.chat", test_dir);
+
+    int rc = chat_create(path);
+    TEST_ASSERT(rc == 0, "T25c: chat_create failed: %d", rc);
+
+    rc = chat_cursor_write_pos(path, "alice", 7, 12345);
+    TEST_ASSERT(rc == 0, "T25c: chat_cursor_write_pos failed: %d", rc);
+    rc = chat_cursor_write(path, "bob", 3); /* legacy: no offset */
+    TEST_ASSERT(rc == 0, "T25c: chat_cursor_write failed: %d", rc);
+
+    int index;
+    int64_t offset;
+    rc = chat_cursor_read_pos(path, "alice", &index, &offset);
+    TEST_ASSERT(rc == 0, "T25c: chat_cursor_read_pos failed: %d", rc);
+    TEST_ASSERT(index == 7, "T25c: index %d != 7", index);
+    TEST_ASSERT(offset == 12345, "T25c: offset %" PRId64 " != 12345", offset);
+
+    rc = chat_cursor_read_pos(path, "bob", &index, &offset);
+    TEST_ASSERT(rc == 0, "T25c: chat_cursor_read_pos (bob) failed: %d", rc);
+    TEST_ASSERT(index == 3, "T25c: bob index %d != 3", index);
+    TEST_ASSERT(offset == -1, "T25c: bob offset %" PRId64 " != -1", offset);
+
+    /* Plain chat_cursor_read still returns the index */
+    TEST_ASSERT(chat_cursor_read(path, "alice") == 7,
+                "T25c: chat_cursor_read != 7");
+
+    cleanup_path(path);
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    TEST_PASS("T25c: cursor index:offset round-trips, legacy entries keep -1");
+}
+
+/* --- ARENA CONTENT STORAGE tests (T26) --- */
+
+/*
+ * Message content is carved from the state's arena. Verify integrity
+ * across an arena block boundary (many small messages) and for an
+ * oversize message that gets a block of its own (> ARENA_BLOCK_SIZE).
+ */
+static void test_arena_content_integrity(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/arena.chat", test_dir);
+
+    int rc = chat_create(path);
+    TEST_ASSERT(rc == 0, "T26: chat_create failed: %d", rc);
+
+    /* An oversize body: 100 KB of a recognisable pattern */
+    size_t big_len = 100 * 1024;
+    char *big = malloc(big_len + 1);
+    TEST_ASSERT(big != NULL, "T26: malloc failed");
+    for (size_t i = 0; i < big_len; i++) big[i] = 'a' + (char)(i % 26);
+    big[big_len] = '\0';
+    TEST_ASSERT(chat_send(path, "alice", big) == 0, "T26: big send failed");
+
+    /* Enough small messages to span several 64 KB arena blocks */
+    char small[600];
+    memset(small, 'x', sizeof(small) - 1);
+    small[sizeof(small) - 1] = '\0';
+    for (int i = 0; i < 300; i++) {
+        TEST_ASSERT(chat_send(path, "bob", small) == 0,
+                    "T26: small send %d failed", i);
+    }
+
+    chat_state_t state;
+    rc = chat_read(path, &state);
+    TEST_ASSERT(rc == 0, "T26: chat_read failed: %d", rc);
+    TEST_ASSERT(state.message_count == 301,
+                "T26: expected 301 messages, got %d", state.message_count);
+    TEST_ASSERT(state.messages[0].content_len == big_len,
+                "T26: big content_len %zu != %zu",
+                state.messages[0].content_len, big_len);
+    TEST_ASSERT(memcmp(state.messages[0].content, big, big_len) == 0,
+                "T26: big content corrupted");
+    for (int i = 1; i <= 300; i++) {
+        TEST_ASSERT(state.messages[i].content_len == sizeof(small) - 1,
+                    "T26: message %d content_len %zu != %zu",
+                    i, state.messages[i].content_len, sizeof(small) - 1);
+        TEST_ASSERT(strcmp(state.messages[i].content, small) == 0,
+                    "T26: message %d content corrupted", i);
+    }
+    chat_state_free(&state);
+    TEST_ASSERT(state.arena == NULL, "T26: arena not released");
+    free(big);
+
+    cleanup_path(path);
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    TEST_PASS("T26: arena-backed content survives block boundaries");
+}
+
+/* --- MESSAGE INDEX SIDECAR tests (T27) --- */
+
+/*
+ * chat_send maintains a <chat>.idx sidecar of fixed-width records.
+ * Verify the count tracks sends and each record's offset is usable
+ * with chat_read_from to decode exactly the messages from there on.
+ */
+static void test_idx_tracks_sends(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/idx.chat", test_dir);
+
+    int rc = chat_create(path);
+    TEST_ASSERT(rc == 0, "T27: chat_create failed: %d", rc);
+    TEST_ASSERT(chat_idx_count(path) == 0,
+                "T27: fresh chat should have an empty index");
+
+    TEST_ASSERT(chat_send(path, "alice", "first") == 0, "T27: send 1 failed");
+    TEST_ASSERT(chat_send(path, "bob", "second") == 0, "T27: send 2 failed");
+    TEST_ASSERT(chat_send(path, "alice", "third") == 0, "T27: send 3 failed");
+    TEST_ASSERT(chat_idx_count(path) == 3,
+                "T27: expected 3 index records, got %d", chat_idx_count(path));
+
+    chat_idx_record_t rec;
+    rc = chat_idx_get(path, 1, &rec);
+    TEST_ASSERT(rc == 0, "T27: chat_idx_get failed: %d", rc);
+    TEST_ASSERT(strcmp(rec.handle, "bob") == 0,
+                "T27: record 1 handle '%s', expected 'bob'", rec.handle);
+    TEST_ASSERT(rec.timestamp > 0, "T27: record 1 has no timestamp");
+    TEST_ASSERT(rec.offset > 0 && rec.length > 0,
+                "T27: record 1 offset/length invalid: %" PRId64 "/%d",
+                rec.offset, rec.length);
+
+    /* The recorded offset must land on message 1's line */
+    chat_state_t state;
+    rc = chat_read_from(path, rec.offset, &state);
+    TEST_ASSERT(rc == 0, "T27: chat_read_from at idx offset failed: %d", rc);
+    TEST_ASSERT(state.message_count == 2,
+                "T27: expected 2 tail messages, got %d", state.message_count);
+    TEST_ASSERT(strcmp(state.messages[0].content, "second") == 0,
+                "T27: tail message 0 is '%s'", state.messages[0].content);
+    chat_state_free(&state);
+
+    /* Out-of-range index is rejected */
+    TEST_ASSERT(chat_idx_get(path, 3, &rec) == -1,
+                "T27: out-of-range chat_idx_get should fail");
+
+    cleanup_path(path);
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.idx", path);
+    cleanup_path(companion);
+    TEST_PASS("T27: index sidecar tracks sends with usable offsets");
+}
+
+/*
+ * An index that disagrees with the chat file's size is stale and must
+ * be reported as absent; the next send repairs it.
+ */
+static void test_idx_staleness_falls_back(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/idx_stale.chat", test_dir);
+
+    int rc = chat_create(path);
+    TEST_ASSERT(rc == 0, "T27: chat_create failed: %d", rc);
+    TEST_ASSERT(chat_send(path, "alice", "hello") == 0, "T27: send failed");
+    TEST_ASSERT(chat_idx_count(path) == 1, "T27: expected 1 record");
+
+    /* Grow the chat file behind the index's back */
+    FILE *f = fopen(path, "a");
+    TEST_ASSERT(f != NULL, "T27: fopen failed: %s", strerror(errno));
+    fputs("bWFsbG9yeTogc25lYWt5\n", f);  /* "mallory: sneaky" */
+    fclose(f);
+
+    TEST_ASSERT(chat_idx_count(path) == -1,
+                "T27: stale index must report -1");
+    chat_idx_record_t rec;
+    TEST_ASSERT(chat_idx_get(path, 0, &rec) == -1 || rec.offset >= 0,
+                "T27: chat_idx_get on stale index misbehaved");
+
+    /* A full-rewrite send rebuilds the index to match reality */
+    TEST_ASSERT(chat_send(path, "bob", "repair") == 0, "T27: repair send failed");
+    chat_state_t state;
+    TEST_ASSERT(chat_read(path, &state) == 0, "T27: chat_read failed");
+    TEST_ASSERT(chat_idx_count(path) == state.message_count,
+                "T27: rebuilt index count %d != message count %d",
+                chat_idx_count(path), state.message_count);
+    chat_state_free(&state);
+
+    cleanup_path(path);
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.idx", path);
+    cleanup_path(companion);
+    TEST_PASS("T27: stale index detected and rebuilt on next send");
+}
+
+/* --- BINARY FORMAT V2 tests (T28) --- */
+
+/*
+ * nbs-chat migrate rewrites a v1 file as v2 binary records. Verify the
+ * round trip preserves messages, handles, timestamps and participants,
+ * that a second migrate reports "already v2", and that sends keep
+ * working (fast path) on the migrated file.
+ */
+static void test_migrate_roundtrip(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/v2.chat", test_dir);
+
+    int rc = chat_create(path);
+    TEST_ASSERT(rc == 0, "T28: chat_create failed: %d", rc);
+    TEST_ASSERT(chat_send(path, "alice", "first message") == 0,
+                "T28: send 1 failed");
+    TEST_ASSERT(chat_send(path, "bob", "second message") == 0,
+                "T28: send 2 failed");
+
+    chat_state_t before;
+    TEST_ASSERT(chat_read(path, &before) == 0, "T28: pre-migrate read failed");
+    TEST_ASSERT(before.format_version == 1,
+                "T28: fresh file should be v1, got %d", before.format_version);
+
+    rc = chat_migrate(path);
+    TEST_ASSERT(rc == 0, "T28: chat_migrate failed: %d", rc);
+    TEST_ASSERT(chat_migrate(path) == 1,
+                "T28: second migrate should report already-v2");
+
+    chat_state_t after;
+    TEST_ASSERT(chat_read(path, &after) == 0, "T28: post-migrate read failed");
+    TEST_ASSERT(after.format_version == 2,
+                "T28: migrated file should be v2, got %d", after.format_version);
+    TEST_ASSERT(after.message_count == before.message_count,
+                "T28: message count %d != %d after migrate",
+                after.message_count, before.message_count);
+    for (int i = 0; i < before.message_count; i++) {
+        TEST_ASSERT(strcmp(after.messages[i].handle,
+                           before.messages[i].handle) == 0,
+                    "T28: handle %d changed across migrate", i);
+        TEST_ASSERT(strcmp(after.messages[i].content,
+                           before.messages[i].content) == 0,
+                    "T28: content %d changed across migrate", i);
+        TEST_ASSERT(after.messages[i].timestamp == before.messages[i].timestamp,
+                    "T28: timestamp %d changed across migrate", i);
+    }
+    TEST_ASSERT(after.participant_count == before.participant_count,
+                "T28: participant count changed across migrate");
+    chat_state_free(&before);
+    chat_state_free(&after);
+
+    /* Sends on the migrated file append binary records */
+    TEST_ASSERT(chat_send(path, "carol", "third message") == 0,
+                "T28: v2 send failed");
+    chat_state_t state;
+    TEST_ASSERT(chat_read(path, &state) == 0, "T28: v2 read failed");
+    TEST_ASSERT(state.message_count == 3,
+                "T28: expected 3 messages after v2 send, got %d",
+                state.message_count);
+    TEST_ASSERT(strcmp(state.messages[2].handle, "carol") == 0 &&
+                strcmp(state.messages[2].content, "third message") == 0,
+                "T28: v2-appended message corrupted: '%s: %s'",
+                state.messages[2].handle, state.messages[2].content);
+    TEST_ASSERT(state.skipped_count == 0,
+                "T28: v2 read skipped %d messages", state.skipped_count);
+    chat_state_free(&state);
+
+    cleanup_path(path);
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.idx", path);
+    cleanup_path(companion);
+    TEST_PASS("T28: migrate round-trips messages and v2 sends append");
+}
+
+/*
+ * The index sidecar is rebuilt by migrate with v2 byte offsets. Verify
+ * the recorded offsets are usable with chat_read_from on the binary
+ * body, and that a misaligned offset is rejected as stale.
+ */
+static void test_v2_offsets_and_idx(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/v2_idx.chat", test_dir);
+
+    TEST_ASSERT(chat_create(path) == 0, "T28: chat_create failed");
+    TEST_ASSERT(chat_send(path, "alice", "one") == 0, "T28: send 1 failed");
+    TEST_ASSERT(chat_send(path, "bob", "two") == 0, "T28: send 2 failed");
+    TEST_ASSERT(chat_migrate(path) == 0, "T28: migrate failed");
+    TEST_ASSERT(chat_send(path, "alice", "three") == 0, "T28: send 3 failed");
+
+    TEST_ASSERT(chat_idx_count(path) == 3,
+                "T28: expected 3 index records, got %d", chat_idx_count(path));
+
+    chat_idx_record_t rec;
+    TEST_ASSERT(chat_idx_get(path, 1, &rec) == 0, "T28: chat_idx_get failed");
+    TEST_ASSERT(strcmp(rec.handle, "bob") == 0,
+                "T28: record 1 handle '%s', expected 'bob'", rec.handle);
+
+    chat_state_t state;
+    int rc = chat_read_from(path, rec.offset, &state);
+    TEST_ASSERT(rc == 0, "T28: chat_read_from at v2 offset failed: %d", rc);
+    TEST_ASSERT(state.message_count == 2,
+                "T28: expected 2 tail messages, got %d", state.message_count);
+    TEST_ASSERT(strcmp(state.messages[0].content, "two") == 0,
+                "T28: tail message 0 is '%s'", state.messages[0].content);
+    chat_state_free(&state);
+
+    /* An offset inside a record is not a record boundary: stale (1) */
+    rc = chat_read_from(path, rec.offset + 2, &state);
+    TEST_ASSERT(rc == 1,
+                "T28: misaligned v2 offset should be stale, got %d", rc);
+
+    cleanup_path(path);
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.idx", path);
+    cleanup_path(companion);
+    TEST_PASS("T28: v2 index offsets usable, misaligned offsets stale");
+}
+
+/* --- WARM-STATE CACHE tests (T29) --- */
+
+static void test_state_cache_serves_and_invalidates(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/cache_test.chat", test_dir);
+
+    TEST_ASSERT(chat_create(path) == 0, "chat_create failed");
+    TEST_ASSERT(chat_send(path, "alice", "first") == 0, "send 1 failed");
+    TEST_ASSERT(chat_send(path, "bob", "second") == 0, "send 2 failed");
+
+    /* Process-wide and sticky, but every other test still passes with
+     * it on: the cache must be behaviour-invisible */
+    chat_state_cache_enable();
+
+    chat_state_t cold;
+    TEST_ASSERT(chat_read(path, &cold) == 0, "cold read failed");
+    TEST_ASSERT(cold.message_count == 2, "cold read: %d messages",
+                cold.message_count);
+
+    /* Warm read is a deep copy of cached state — identical content,
+     * distinct storage */
+    chat_state_t warm;
+    TEST_ASSERT(chat_read(path, &warm) == 0, "warm read failed");
+    TEST_ASSERT(warm.message_count == 2, "warm read: %d messages",
+                warm.message_count);
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT(strcmp(warm.messages[i].handle,
+                           cold.messages[i].handle) == 0 &&
+                    strcmp(warm.messages[i].content,
+                           cold.messages[i].content) == 0 &&
+                    warm.messages[i].timestamp == cold.messages[i].timestamp,
+                    "warm message %d differs from cold", i);
+        TEST_ASSERT(warm.messages[i].content != cold.messages[i].content,
+                    "warm copy shares storage with cold state");
+    }
+    TEST_ASSERT(warm.file_length == cold.file_length,
+                "file_length differs: %" PRId64 " vs %" PRId64,
+                warm.file_length, cold.file_length);
+    chat_state_free(&cold);
+    chat_state_free(&warm);
+
+    /* A send changes size/mtime — the next read must see it */
+    TEST_ASSERT(chat_send(path, "carol", "third") == 0, "send 3 failed");
+    chat_state_t fresh;
+    TEST_ASSERT(chat_read(path, &fresh) == 0, "post-send read failed");
+    TEST_ASSERT(fresh.message_count == 3,
+                "stale cache served after send: %d messages",
+                fresh.message_count);
+    TEST_ASSERT(strcmp(fresh.messages[2].content, "third") == 0,
+                "third message content '%s'", fresh.messages[2].content);
+    chat_state_free(&fresh);
+
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.idx", path);
+    cleanup_path(companion);
+    cleanup_path(path);
+    TEST_PASS("T29: warm-state cache hits copy, writes invalidate");
+}
+
+static void test_stream_reads_one_message_at_a_time(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/stream_test.chat", test_dir);
+
+    TEST_ASSERT(chat_create(path) == 0, "chat_create failed");
+    TEST_ASSERT(chat_send(path, "alice", "first") == 0, "send 1 failed");
+    TEST_ASSERT(chat_send(path, "bob", "second") == 0, "send 2 failed");
+    TEST_ASSERT(chat_send(path, "alice", "third") == 0, "send 3 failed");
+
+    const char *want[3] = { "first", "second", "third" };
+    const char *who[3] = { "alice", "bob", "alice" };
+
+    /* v1 stream */
+    chat_stream_t *st = chat_open_stream(path);
+    TEST_ASSERT(st != NULL, "open stream failed");
+    chat_message_t msg;
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT(chat_next_message(st, &msg) == 0, "next %d failed", i);
+        TEST_ASSERT(strcmp(msg.handle, who[i]) == 0 &&
+                    strcmp(msg.content, want[i]) == 0 &&
+                    msg.content_len == strlen(want[i]) &&
+                    msg.timestamp > 0,
+                    "stream message %d is '%s: %s'", i, msg.handle,
+                    msg.content);
+    }
+    TEST_ASSERT(chat_next_message(st, &msg) == 1,
+                "stream should report end after last message");
+    TEST_ASSERT(chat_stream_skipped(st) == 0,
+                "stream skipped %d messages", chat_stream_skipped(st));
+    chat_close_stream(st);
+
+    /* Same sequence through the v2 binary format */
+    TEST_ASSERT(chat_migrate(path) == 0, "migrate failed");
+    st = chat_open_stream(path);
+    TEST_ASSERT(st != NULL, "open v2 stream failed");
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT(chat_next_message(st, &msg) == 0, "v2 next %d failed", i);
+        TEST_ASSERT(strcmp(msg.handle, who[i]) == 0 &&
+                    strcmp(msg.content, want[i]) == 0,
+                    "v2 stream message %d is '%s: %s'", i, msg.handle,
+                    msg.content);
+    }
+    TEST_ASSERT(chat_next_message(st, &msg) == 1, "v2 stream end");
+    chat_close_stream(st);
+
+    TEST_ASSERT(chat_open_stream("/nonexistent/stream.chat") == NULL,
+                "stream open of a missing file should fail");
+
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.idx", path);
+    cleanup_path(companion);
+    cleanup_path(path);
+    TEST_PASS("T33: stream yields messages one at a time in both formats");
+}
+
+static void test_segment_rotation_and_lazy_read(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/segment_test.chat", test_dir);
+
+    TEST_ASSERT(chat_create(path) == 0, "chat_create failed");
+    TEST_ASSERT(setenv("NBS_CHAT_SEGMENT_MSGS", "3", 1) == 0, "setenv failed");
+
+    /* Sends 1-3 fill the active file; send 4 seals it into .seg.0001;
+     * send 7 seals again. Active ends up holding only message 7. */
+    for (int i = 1; i <= 7; i++) {
+        char msg[32];
+        snprintf(msg, sizeof(msg), "msg%d", i);
+        TEST_ASSERT(chat_send(path, "alice", msg) == 0, "send %d failed", i);
+    }
+    unsetenv("NBS_CHAT_SEGMENT_MSGS");
+
+    TEST_ASSERT(chat_segment_count(path) == 2,
+                "expected 2 sealed segments, got %d",
+                chat_segment_count(path));
+
+    chat_state_t active;
+    TEST_ASSERT(chat_read(path, &active) == 0, "active read failed");
+    TEST_ASSERT(active.message_count == 1 &&
+                strcmp(active.messages[0].content, "msg7") == 0,
+                "active file should hold only msg7, has %d messages",
+                active.message_count);
+    TEST_ASSERT(active.participant_count == 1 &&
+                strcmp(active.participants[0].handle, "alice") == 0,
+                "participant tally lost across rotation");
+    chat_state_free(&active);
+
+    /* Full history: all segments merged, oldest first */
+    chat_state_t all;
+    TEST_ASSERT(chat_read_segments(path, -1, &all) == 0, "full read failed");
+    TEST_ASSERT(all.message_count == 7, "expected 7 messages, got %d",
+                all.message_count);
+    for (int i = 0; i < 7; i++) {
+        char want[32];
+        snprintf(want, sizeof(want), "msg%d", i + 1);
+        TEST_ASSERT(strcmp(all.messages[i].content, want) == 0,
+                    "message %d is '%s', want '%s'",
+                    i, all.messages[i].content, want);
+    }
+    chat_state_free(&all);
+
+    /* want_last=2 needs one sealed segment, not both: active(1) +
+     * seg.0002(3) = 4 messages, and seg.0001 stays cold on disk */
+    chat_state_t part;
+    TEST_ASSERT(chat_read_segments(path, 2, &part) == 0, "lazy read failed");
+    TEST_ASSERT(part.message_count == 4,
+                "lazy read should stop after one segment, got %d messages",
+                part.message_count);
+    TEST_ASSERT(strcmp(part.messages[0].content, "msg4") == 0 &&
+                strcmp(part.messages[3].content, "msg7") == 0,
+                "lazy read range wrong: '%s' .. '%s'",
+                part.messages[0].content, part.messages[3].content);
+    chat_state_free(&part);
+
+    char companion[600];
+    for (int n = 1; n <= 2; n++) {
+        snprintf(companion, sizeof(companion), "%s.seg.%04d", path, n);
+        cleanup_path(companion);
+        snprintf(companion, sizeof(companion), "%s.seg.%04d.idx", path, n);
+        cleanup_path(companion);
+        snprintf(companion, sizeof(companion), "%s.seg.%04d.cursors", path, n);
+        cleanup_path(companion);
+    }
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.idx", path);
+    cleanup_path(companion);
+    cleanup_path(path);
+    TEST_PASS("T32: segment rotation seals full files, reads merge lazily");
+}
+
+static void test_cursor_binary_format_and_migration(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/cursor_binary.chat", test_dir);
+
+    TEST_ASSERT(chat_create(path) == 0, "chat_create failed");
+
+    char cpath[600];
+    snprintf(cpath, sizeof(cpath), "%s.cursors", path);
+
+    /* Seed a legacy text cursor file: the first write must migrate it
+     * to the binary table without losing the other handles' entries */
+    FILE *f = fopen(cpath, "w");
+    TEST_ASSERT(f != NULL, "fopen cursor file failed");
+    fputs("# Read cursors\nalice=3:120\nbob=7\n", f);
+    fclose(f);
+
+    TEST_ASSERT(chat_cursor_write_pos(path, "carol", 2, 64) == 0,
+                "cursor write (migrating) failed");
+
+    /* File now starts with the binary magic line */
+    char magic[32];
+    f = fopen(cpath, "rb");
+    TEST_ASSERT(f != NULL, "reopen cursor file failed");
+    size_t n = fread(magic, 1, 25, f);
+    fclose(f);
+    TEST_ASSERT(n == 25 && memcmp(magic, "=== nbs-chat cursors ===\n", 25) == 0,
+                "cursor file was not migrated to the binary format");
+
+    /* Text entries survived migration, new entry present */
+    int index;
+    int64_t offset;
+    TEST_ASSERT(chat_cursor_read_pos(path, "alice", &index, &offset) == 0 &&
+                index == 3 && offset == 120,
+                "alice cursor lost in migration: %d:%" PRId64, index, offset);
+    TEST_ASSERT(chat_cursor_read_pos(path, "bob", &index, &offset) == 0 &&
+                index == 7 && offset == -1,
+                "bob cursor lost in migration: %d:%" PRId64, index, offset);
+    TEST_ASSERT(chat_cursor_read_pos(path, "carol", &index, &offset) == 0 &&
+                index == 2 && offset == 64,
+                "carol cursor wrong after migration: %d:%" PRId64,
+                index, offset);
+
+    /* Updates go through the in-place slot path: size must not change */
+    struct stat before, after;
+    TEST_ASSERT(stat(cpath, &before) == 0, "stat before update failed");
+    TEST_ASSERT(chat_cursor_write_pos(path, "alice", 9, 512) == 0,
+                "in-place cursor update failed");
+    TEST_ASSERT(stat(cpath, &after) == 0, "stat after update failed");
+    TEST_ASSERT(before.st_size == after.st_size,
+                "slot update changed the file size");
+    TEST_ASSERT(chat_cursor_read_pos(path, "alice", &index, &offset) == 0 &&
+                index == 9 && offset == 512,
+                "alice cursor wrong after update: %d:%" PRId64, index, offset);
+    TEST_ASSERT(chat_cursor_read(path, "nobody") == -1,
+                "absent handle should read as -1");
+
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.idx", path);
+    cleanup_path(companion);
+    cleanup_path(cpath);
+    cleanup_path(path);
+    TEST_PASS("T31: binary cursor table migrates from text, updates in place");
+}
+
+static void test_snapshot_mode_roundtrip(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/snapshot_test.chat", test_dir);
+
+    TEST_ASSERT(chat_create(path) == 0, "chat_create failed");
+    TEST_ASSERT(chat_snapshot_enable(path) == 0, "snapshot enable failed");
+    TEST_ASSERT(chat_snapshot_enable(path) == 0,
+                "snapshot enable is not idempotent");
+
+    char marker[600];
+    snprintf(marker, sizeof(marker), "%s.snapshot", path);
+    struct stat st;
+    TEST_ASSERT(stat(marker, &st) == 0, "marker sidecar missing");
+
+    /* Sends take the rename-publication path; reads take no lock.
+     * Content must round-trip exactly as in locked mode. */
+    TEST_ASSERT(chat_send(path, "alice", "first") == 0, "send 1 failed");
+    TEST_ASSERT(chat_send(path, "bob", "second") == 0, "send 2 failed");
+
+    chat_state_t state;
+    TEST_ASSERT(chat_read(path, &state) == 0, "read failed");
+    TEST_ASSERT(state.message_count == 2, "read: %d messages",
+                state.message_count);
+    TEST_ASSERT(strcmp(state.messages[0].content, "first") == 0 &&
+                strcmp(state.messages[1].content, "second") == 0,
+                "message content did not round-trip");
+    int64_t end = state.end_offset;
+    chat_state_free(&state);
+
+    /* The padded header keeps prior records at fixed offsets, so a
+     * tail read survives the whole-file republication */
+    TEST_ASSERT(chat_send(path, "carol", "third") == 0, "send 3 failed");
+    chat_state_t tail;
+    TEST_ASSERT(chat_read_from(path, end, &tail) == 0, "tail read failed");
+    TEST_ASSERT(tail.message_count == 1 &&
+                strcmp(tail.messages[0].content, "third") == 0,
+                "tail read saw %d messages", tail.message_count);
+    chat_state_free(&tail);
+
+    /* No stray temp file left behind by publication */
+    char tmp[600];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    TEST_ASSERT(stat(tmp, &st) != 0, "temp file left behind");
+
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.idx", path);
+    cleanup_path(companion);
+    cleanup_path(marker);
+    cleanup_path(path);
+    TEST_PASS("T30: snapshot mode publishes by rename, reads lock-free");
+}
+
+static void test_send_batch_group_commit(void) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/batch_test.chat", test_dir);
+
+    TEST_ASSERT(chat_create(path) == 0, "chat_create failed");
+    TEST_ASSERT(chat_send(path, "alice", "hello") == 0, "seed send failed");
+
+    const char *burst[3] = {"one", "two", "three"};
+    TEST_ASSERT(chat_send_batch(path, "bob", burst, 3) == 0,
+                "batch send failed");
+
+    chat_state_t state;
+    TEST_ASSERT(chat_read(path, &state) == 0, "read failed");
+    TEST_ASSERT(state.message_count == 4, "read: %d messages",
+                state.message_count);
+    TEST_ASSERT(strcmp(state.messages[1].content, "one") == 0 &&
+                strcmp(state.messages[2].content, "two") == 0 &&
+                strcmp(state.messages[3].content, "three") == 0,
+                "batch messages out of order or corrupted");
+    TEST_ASSERT(strcmp(state.messages[3].handle, "bob") == 0,
+                "batch handle did not round-trip");
+    /* The burst is one commit: all three share a timestamp */
+    TEST_ASSERT(state.messages[1].timestamp == state.messages[3].timestamp,
+                "batch timestamps differ within one commit");
+    int found_bob = 0;
+    for (int i = 0; i < state.participant_count; i++) {
+        if (strcmp(state.participants[i].handle, "bob") == 0)
+            found_bob = state.participants[i].count;
+    }
+    TEST_ASSERT(found_bob == 3, "bob's participant tally is %d, want 3",
+                found_bob);
+    int64_t end = state.end_offset;
+    chat_state_free(&state);
+
+    /* Cursor-on-write covers the whole burst: sender has no unread */
+    int idx = -1;
+    int64_t off = -1;
+    TEST_ASSERT(chat_cursor_read_pos(path, "bob", &idx, &off) == 0,
+                "cursor read failed");
+    TEST_ASSERT(idx == 3 && off == end,
+                "cursor after batch is (%d, %lld), want (3, %lld)",
+                idx, (long long)off, (long long)end);
+
+    /* An empty batch is a no-op, not an error */
+    TEST_ASSERT(chat_send_batch(path, "bob", NULL, 0) == 0,
+                "empty batch failed");
+
+    char companion[600];
+    snprintf(companion, sizeof(companion), "%s.lock", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.cursors", path);
+    cleanup_path(companion);
+    snprintf(companion, sizeof(companion), "%s.idx", path);
+    cleanup_path(companion);
+    cleanup_path(path);
+    TEST_PASS("T34: batch send appends a burst as one group commit");
+}
+
 /* --- Main --- */
 
 int main(void) {
@@ -1031,6 +2034,38 @@ int main(void) {
     test_timestamp_file_length_invariant();
     test_timestamp_content_with_pipe();
 
+    /* APPEND FAST PATH tests (T23) */
+    test_append_fast_path_sequence();
+    test_append_legacy_migration();
+
+    /* EVENT-DRIVEN POLL tests (T24) */
+    test_poll_wakes_on_send();
+    test_poll_ignores_own_send();
+
+    /* INCREMENTAL TAIL READ tests (T25) */
+    test_read_from_tail();
+    test_read_from_stale_offset();
+    test_cursor_offset_roundtrip();
+
+    /* ARENA CONTENT STORAGE tests (T26) */
+    test_arena_content_integrity();
+
+    /* MESSAGE INDEX SIDECAR tests (T27) */
+    test_idx_tracks_sends();
+    test_idx_staleness_falls_back();
+
+    /* BINARY FORMAT V2 tests (T28) */
+    test_migrate_roundtrip();
+    test_v2_offsets_and_idx();
+
+    /* WARM-STATE CACHE tests (T29) */
+    test_stream_reads_one_message_at_a_time();
+    test_segment_rotation_and_lazy_read();
+    test_cursor_binary_format_and_migration();
+    test_snapshot_mode_roundtrip();
+    test_send_batch_group_commit();
+    test_state_cache_serves_and_invalidates();
+
     printf("\n=== Results: %d passed, %d failed ===\n",
            tests_passed, tests_failed);
 
@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -231,6 +232,77 @@ static void test_sequential_acquire_release(void) {
     TEST_PASS("10 sequential acquire/release cycles");
 }
 
+/* --- Test shared locks admit concurrent readers --- */
+
+static void test_shared_locks_concurrent(void) {
+    char path[256];
+    make_temp_path(path, sizeof(path));
+
+    int fd = chat_lock_acquire_shared(path);
+    TEST_ASSERT(fd >= 0, "chat_lock_acquire_shared failed: %d", fd);
+
+    /* A second reader in another process must acquire immediately.
+     * Exit code 0 = acquired; the blocking F_SETLKW would hang the
+     * child (and fail the waitpid check) if shared locks conflicted. */
+    pid_t pid = fork();
+    TEST_ASSERT(pid >= 0, "fork failed: %s", strerror(errno));
+    if (pid == 0) {
+        int cfd = chat_lock_acquire_shared(path);
+        if (cfd < 0) _exit(1);
+        chat_lock_release(cfd);
+        _exit(0);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                "second reader failed to acquire shared lock");
+
+    chat_lock_release(fd);
+    cleanup_lock_file(path);
+    TEST_PASS("shared locks admit concurrent readers");
+}
+
+/* --- Test a shared lock still excludes writers --- */
+
+static void test_shared_lock_blocks_writer(void) {
+    char path[256];
+    make_temp_path(path, sizeof(path));
+
+    int fd = chat_lock_acquire_shared(path);
+    TEST_ASSERT(fd >= 0, "chat_lock_acquire_shared failed: %d", fd);
+
+    /* From another process, a non-blocking exclusive attempt must fail
+     * while the reader holds F_RDLCK. */
+    pid_t pid = fork();
+    TEST_ASSERT(pid >= 0, "fork failed: %s", strerror(errno));
+    if (pid == 0) {
+        char lock_path[MAX_PATH_LEN];
+        snprintf(lock_path, sizeof(lock_path), "%s.lock", path);
+        int cfd = open(lock_path, O_RDWR | O_CLOEXEC);
+        if (cfd < 0) _exit(2);
+        struct flock fl = {
+            .l_type = F_WRLCK,
+            .l_whence = SEEK_SET,
+            .l_start = 0,
+            .l_len = 0,
+        };
+        /* Non-blocking: EAGAIN/EACCES expected while the reader holds on */
+        if (fcntl(cfd, F_SETLK, &fl) == 0) _exit(1);
+        _exit((errno == EAGAIN || errno == EACCES) ? 0 : 2);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                "writer acquired exclusive lock past a shared holder (exit %d)",
+                WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+
+    chat_lock_release(fd);
+    cleanup_lock_file(path);
+    TEST_PASS("shared lock still excludes writers");
+}
+
 int main(void) {
     printf("=== lock unit tests ===\n\n");
 
@@ -241,6 +313,8 @@ int main(void) {
     test_double_release();
     test_lock_file_permissions();
     test_sequential_acquire_release();
+    test_shared_locks_concurrent();
+    test_shared_lock_blocks_writer();
 
     printf("\n=== Results: %d passed, %d failed ===\n",
            tests_passed, tests_failed);
@@ -291,6 +291,9 @@ static remote_config_t make_test_config(void) {
     cfg.key_path = NULL;
     cfg.remote_bin = "nbs-chat";
     cfg.ssh_opts = NULL;
+    cfg.mux_persist_s = 0;       /* multiplexing off unless a test enables it */
+    cfg.mux_path_opt[0] = '\0';
+    cfg.mux_persist_opt[0] = '\0';
     return cfg;
 }
 
@@ -583,6 +586,216 @@ static void test_build_ssh_argv_format_specifier_in_host(void) {
 
 /* ── Entry point ────────────────────────────────────────────────── */
 
+/* ── multiplexing (ControlMaster) tests ─────────────────────────── */
+
+static void test_mux_options_in_argv(void) {
+    remote_config_t cfg = make_test_config();
+    snprintf(cfg.mux_path_opt, sizeof(cfg.mux_path_opt),
+             "ControlPath=/tmp/nbs-chat-mux-test/%%C");
+    snprintf(cfg.mux_persist_opt, sizeof(cfg.mux_persist_opt),
+             "ControlPersist=60s");
+
+    char *argv_in[] = { "nbs-chat-remote", "read", "/tmp/chat.nbs", NULL };
+    char *opts_out = NULL;
+    char *port_str_out = NULL;
+
+    char **result = build_ssh_argv(&cfg, 3, argv_in, &opts_out, &port_str_out);
+    TEST_ASSERT(result != NULL, "build_ssh_argv returned NULL");
+
+    /* The three -o mux options must precede the host */
+    int found_master = 0, found_path = 0, found_persist = 0, host_at = -1;
+    for (int i = 0; result[i] != NULL; i++) {
+        if (strcmp(result[i], "ControlMaster=auto") == 0) found_master = i;
+        if (strcmp(result[i], cfg.mux_path_opt) == 0) found_path = i;
+        if (strcmp(result[i], cfg.mux_persist_opt) == 0) found_persist = i;
+        if (strcmp(result[i], "user@testhost") == 0) host_at = i;
+    }
+    TEST_ASSERT(found_master && found_path && found_persist,
+                "mux options missing from argv (master=%d path=%d persist=%d)",
+                found_master, found_path, found_persist);
+    TEST_ASSERT(host_at > found_persist,
+                "mux options must come before the host (host=%d persist=%d)",
+                host_at, found_persist);
+
+    for (int j = 0; result[j] != NULL; j++) {
+        if (result[j + 1] == NULL) {
+            free(result[j]);
+            break;
+        }
+    }
+    free(opts_out);
+    free(port_str_out);
+    free(result);
+
+    TEST_PASS("mux: ControlMaster options appear in argv before host");
+}
+
+static void test_mux_disabled_omits_options(void) {
+    remote_config_t cfg = make_test_config(); /* mux off */
+    char *argv_in[] = { "nbs-chat-remote", "read", "/tmp/chat.nbs", NULL };
+    char *opts_out = NULL;
+    char *port_str_out = NULL;
+
+    char **result = build_ssh_argv(&cfg, 3, argv_in, &opts_out, &port_str_out);
+    TEST_ASSERT(result != NULL, "build_ssh_argv returned NULL");
+
+    for (int i = 0; result[i] != NULL; i++)
+        TEST_ASSERT(strstr(result[i], "ControlMaster") == NULL,
+                    "ControlMaster option present with multiplexing off");
+
+    for (int j = 0; result[j] != NULL; j++) {
+        if (result[j + 1] == NULL) {
+            free(result[j]);
+            break;
+        }
+    }
+    free(opts_out);
+    free(port_str_out);
+    free(result);
+
+    TEST_PASS("mux: no ControlMaster options when disabled");
+}
+
+static void test_mux_env_parsing(void) {
+    setenv("NBS_CHAT_HOST", "user@testhost", 1);
+
+    /* Invalid value is a configuration error */
+    setenv("NBS_CHAT_MUX", "banana", 1);
+    remote_config_t cfg;
+    TEST_ASSERT(load_config(&cfg) == 4,
+                "load_config should reject NBS_CHAT_MUX=banana");
+
+    /* off disables multiplexing entirely */
+    setenv("NBS_CHAT_MUX", "off", 1);
+    TEST_ASSERT(load_config(&cfg) == 0, "load_config failed for MUX=off");
+    TEST_ASSERT(cfg.mux_persist_s == 0 && cfg.mux_path_opt[0] == '\0',
+                "MUX=off should disable multiplexing");
+
+    /* An explicit duration flows into ControlPersist */
+    setenv("NBS_CHAT_MUX", "120", 1);
+    TEST_ASSERT(load_config(&cfg) == 0, "load_config failed for MUX=120");
+    if (cfg.mux_path_opt[0] != '\0') {
+        TEST_ASSERT(strncmp(cfg.mux_path_opt, "ControlPath=", 12) == 0,
+                    "mux_path_opt malformed: %s", cfg.mux_path_opt);
+        TEST_ASSERT(strcmp(cfg.mux_persist_opt, "ControlPersist=120s") == 0,
+                    "mux_persist_opt = '%s', want ControlPersist=120s",
+                    cfg.mux_persist_opt);
+    }
+
+    unsetenv("NBS_CHAT_MUX");
+    unsetenv("NBS_CHAT_HOST");
+    TEST_PASS("mux: NBS_CHAT_MUX parsing (invalid, off, duration)");
+}
+
+/* ── batch mode tests ───────────────────────────────────────────── */
+
+static void test_tokenize_basic(void) {
+    char line[] = "send /tmp/chat.nbs alice hello\n";
+    char *words[8];
+    int n = tokenize_line(line, words, 8);
+    TEST_ASSERT(n == 4, "expected 4 words, got %d", n);
+    TEST_ASSERT(strcmp(words[0], "send") == 0, "words[0] = '%s'", words[0]);
+    TEST_ASSERT(strcmp(words[3], "hello") == 0, "words[3] = '%s'", words[3]);
+    TEST_PASS("tokenize_line: basic whitespace split");
+}
+
+static void test_tokenize_quotes(void) {
+    char line[] = "send /c alice 'hello there' \"it\\\"s ok\"";
+    char *words[8];
+    int n = tokenize_line(line, words, 8);
+    TEST_ASSERT(n == 5, "expected 5 words, got %d", n);
+    TEST_ASSERT(strcmp(words[3], "hello there") == 0,
+                "single-quoted word = '%s'", words[3]);
+    TEST_ASSERT(strcmp(words[4], "it\"s ok") == 0,
+                "double-quoted word = '%s'", words[4]);
+    TEST_PASS("tokenize_line: quoted words keep spaces");
+}
+
+static void test_tokenize_unterminated(void) {
+    char line[] = "send 'oops";
+    char *words[8];
+    TEST_ASSERT(tokenize_line(line, words, 8) == -1,
+                "unterminated quote should return -1");
+    char line2[] = "a b c d";
+    TEST_ASSERT(tokenize_line(line2, words, 2) == -1,
+                "too many words should return -1");
+    TEST_PASS("tokenize_line: unterminated quote and overflow rejected");
+}
+
+static void test_batch_cmd_executes(void) {
+    /* The generated program is plain POSIX sh — run it locally with
+     * echo standing in for the remote nbs-chat to verify framing,
+     * escaping and exit-code propagation end to end */
+    remote_config_t cfg = make_test_config();
+    cfg.remote_bin = "echo";
+
+    char input[] = "hello world\nquoted 'two words'\n";
+    FILE *in = fmemopen(input, strlen(input), "r");
+    TEST_ASSERT(in != NULL, "fmemopen failed");
+    char *cmd = build_batch_remote_cmd(&cfg, in);
+    fclose(in);
+    TEST_ASSERT(cmd != NULL, "build_batch_remote_cmd returned NULL");
+
+    FILE *out = popen(cmd, "r");
+    TEST_ASSERT(out != NULL, "popen failed");
+    char output[1024] = {0};
+    size_t got = fread(output, 1, sizeof(output) - 1, out);
+    int status = pclose(out);
+    free(cmd);
+
+    TEST_ASSERT(got > 0, "no output from batch program");
+    TEST_ASSERT(strstr(output, "hello world\n") != NULL,
+                "first command output missing: '%s'", output);
+    TEST_ASSERT(strstr(output, "quoted two words\n") != NULL,
+                "quoted word not preserved: '%s'", output);
+    TEST_ASSERT(strstr(output, "--- batch:1 exit:0 ---") != NULL &&
+                strstr(output, "--- batch:2 exit:0 ---") != NULL,
+                "delimiters missing: '%s'", output);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                "batch program exited %d", WEXITSTATUS(status));
+
+    TEST_PASS("batch: generated sh program runs commands with delimiters");
+}
+
+static void test_batch_cmd_propagates_failure(void) {
+    /* sh as the "remote binary" lets a line exit non-zero on demand */
+    remote_config_t cfg = make_test_config();
+    cfg.remote_bin = "sh";
+
+    char input[] = "-c 'exit 3'\n-c 'exit 0'\n";
+    FILE *in = fmemopen(input, strlen(input), "r");
+    TEST_ASSERT(in != NULL, "fmemopen failed");
+    char *cmd = build_batch_remote_cmd(&cfg, in);
+    fclose(in);
+    TEST_ASSERT(cmd != NULL, "build_batch_remote_cmd returned NULL");
+
+    FILE *out = popen(cmd, "r");
+    TEST_ASSERT(out != NULL, "popen failed");
+    char output[512] = {0};
+    (void)!fread(output, 1, sizeof(output) - 1, out);
+    int status = pclose(out);
+    free(cmd);
+
+    TEST_ASSERT(strstr(output, "--- batch:1 exit:3 ---") != NULL,
+                "per-command exit code missing: '%s'", output);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 3,
+                "batch should exit with first failure (3), got %d",
+                WEXITSTATUS(status));
+
+    TEST_PASS("batch: first non-zero exit code propagates");
+}
+
+static void test_batch_cmd_empty_input(void) {
+    remote_config_t cfg = make_test_config();
+    char input[] = "\n   \n";
+    FILE *in = fmemopen(input, strlen(input), "r");
+    TEST_ASSERT(in != NULL, "fmemopen failed");
+    char *cmd = build_batch_remote_cmd(&cfg, in);
+    fclose(in);
+    TEST_ASSERT(cmd == NULL, "empty batch should return NULL");
+    TEST_PASS("batch: empty stdin rejected");
+}
+
 int main(void) {
     printf("=== remote.c unit tests ===\n\n");
 
@@ -622,6 +835,19 @@ int main(void) {
     test_build_ssh_argv_escapes_quotes_in_args();
     test_build_ssh_argv_format_specifier_in_host();
 
+    /* multiplexing tests */
+    test_mux_options_in_argv();
+    test_mux_disabled_omits_options();
+    test_mux_env_parsing();
+
+    /* batch mode tests */
+    test_tokenize_basic();
+    test_tokenize_quotes();
+    test_tokenize_unterminated();
+    test_batch_cmd_executes();
+    test_batch_cmd_propagates_failure();
+    test_batch_cmd_empty_input();
+
     printf("\n=== Results: %d passed, %d failed ===\n",
            tests_passed, tests_failed);
 